@@ -0,0 +1,663 @@
+#include "minesweeper.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+
+#include "board.h"
+#include "environment.h"
+#include "observation.h"
+#include "basic_solvers.h"
+#include "bitsliced_solver.h"
+#include "pattern_solver.h"
+#include "elimination_solver.h"
+#include "probability_solver.h"
+#include "lookahead_solver.h"
+#include "endgame_solver.h"
+#include "board_analysis.h"
+#include "board_formats.h"
+
+/*
+minesweeper_bench measures the hot paths of the engine and the renderer.
+
+	minesweeper_bench [--filter TEXT] [--min-time SECONDS] [--json FILE]
+	                  [--baseline FILE] [--threshold PERCENT]
+
+Every benchmark is run REPETITIONS times for at least --min-time seconds each
+and the median time per operation is reported. --json writes the results
+(use - for stdout); --baseline compares them with a file written earlier by
+--json and exits with status 1 if any benchmark got slower by more than
+--threshold percent (10 by default). A benchmark that can't run on its input
+is reported as skipped and left out of the JSON and of the comparison.
+*/
+#define REPETITIONS 5
+//benchmarks on random boards cycle through the boards of these many fixed
+//seeds, so runs compare with a baseline
+#define BENCH_SEEDS 16
+
+//handed to every benchmark body. Only the time between start() and stop() is
+//measured, so bodies can prepare their input without skewing the result
+class BenchState
+{
+public:
+	BenchState() : _elapsed(0), _items(1), _skipped(nullptr) {}
+
+	void start() { _start = Clock::now(); }
+	void stop() { _elapsed += std::chrono::duration<double, std::nano>(Clock::now() - _start).count(); }
+	void setItems(long items) { _items = items; }
+	//ends the benchmark, for the given reason, without a result
+	void skip(const char* reason) { _skipped = reason; }
+
+	double _elapsed;
+	long _items;
+	const char* _skipped;
+
+private:
+	Clock::time_point _start;
+};
+
+//keeps the compiler from hoisting or dropping work whose result is unused
+template <typename T>
+static void doNotOptimize(const T& value) {
+	asm volatile("" : : "r,m"(value) : "memory");
+}
+
+struct BenchResult {
+	std::string name;
+	double ns_per_op;
+	double items_per_sec;
+	long iterations;
+	const char* skipped;
+};
+
+struct Benchmark {
+	std::string name;
+	std::function<void(BenchState&)> body;
+};
+
+static BenchResult runBenchmark(const Benchmark& bench, double min_time) {
+	std::vector<double> samples;
+	long iterations = 0;
+	//the items of an operation may change from one input to the next, so
+	//their average is used
+	double items = 0;
+
+	for (int rep = 0; rep < REPETITIONS; rep++) {
+		BenchState state;
+		long n = 0;
+		while(state._elapsed < min_time*1e9/REPETITIONS) {
+			bench.body(state);
+			if(state._skipped)
+				return {bench.name, 0, 0, iterations, state._skipped};
+			items += state._items;
+			n++;
+		}
+		samples.push_back(state._elapsed/n);
+		iterations += n;
+	}
+
+	std::sort(samples.begin(), samples.end());
+	double median = samples[REPETITIONS/2];
+	return {bench.name, median, items/iterations*1e9/median, iterations, nullptr};
+}
+
+/*************************************************************************
+Benchmarks
+*************************************************************************/
+
+struct Size {
+	int height, width;
+	const char* label;
+};
+
+static std::string sizeName(int height, int width) {
+	std::ostringstream out;
+	out << width << "x" << height;
+	return out.str();
+}
+
+//explores every cell in the left half of the board that has no bomb and flags
+//every bomb in the right half, so the renderer sees every kind of square
+template <class B>
+static void halfExplore(B& board) {
+	for (int i = 0; i < board.height(); i++)
+		for (int j = 0; j < board.width(); j++) {
+			Cell probe = board.cell(i, j);
+			bool bomb = probe.explore() == BOMB;
+			if(j < board.width()/2 && !bomb)
+				board.explore(i, j);
+			else if(j >= board.width()/2 && bomb)
+				board.toggleFlag(i, j);
+		}
+}
+
+//explores every tenth cell with no bomb, scattered, so the frontier is made
+//of many components of every size
+template <class B>
+static void scatterExplore(B& board) {
+	for (int i = 0; i < board.height(); i++)
+		for (int j = 0; j < board.width(); j++) {
+			Cell probe = board.cell(i, j);
+			if((i*7+j*3)%10 == 0 && probe.explore() != BOMB)
+				board.explore(i, j);
+		}
+}
+
+//returns the first cell with no bombs around it, or (-1, -1)
+template <class B>
+static std::pair<int, int> findOpening(const B& board) {
+	for (int i = 0; i < board.height(); i++)
+		for (int j = 0; j < board.width(); j++) {
+			Cell probe = board.cell(i, j);
+			if(probe.explore() == FREE && probe.getContent() == 0)
+				return {i, j};
+		}
+	return {-1, -1};
+}
+
+template <int H, int W>
+static void addFixedInitBoard(std::vector<Benchmark>& benches, int bombs) {
+	benches.push_back({"initBoard/" + sizeName(H, W) + "/" + std::to_string(bombs) + "/fixed", [=](BenchState& state) {
+		Grid<H, W> grid;
+		typename Grid<H, W>::template Array<Cell> cells;
+		grid.allocate(cells, Cell(), Cell::sentinel());
+		state.start();
+		Cell::initBoard(cells, grid, bombs, 1);
+		state.stop();
+		doNotOptimize(cells.data());
+		state.setItems(H*W);
+	}});
+}
+
+template <int H, int W>
+static void addFixedOpening(std::vector<Benchmark>& benches) {
+	benches.push_back({"openFreeSpace/empty/" + sizeName(H, W) + "/fixed", [=](BenchState& state) {
+		Board<H, W> board(0);
+		state.start();
+		board.explore(0, 0);
+		state.stop();
+		state.setItems(H*W);
+	}});
+}
+
+template <int H, int W>
+static void addFixedFork(std::vector<Benchmark>& benches) {
+	auto board = std::make_shared<std::unique_ptr<Board<H, W>>>();
+	benches.push_back({"fork/" + sizeName(H, W) + "/fixed", [=](BenchState& state) {
+		if(!*board) {
+			board->reset(new Board<H, W>(H*W/10));
+			halfExplore(**board);
+		}
+		state.start();
+		BoardState<H, W> copy = (*board)->fork();
+		state.stop();
+		doNotOptimize(copy.revealed());
+		state.setItems(1);
+	}});
+}
+
+template <int H, int W>
+static void addEnvStep(std::vector<Benchmark>& benches, int bombs) {
+	const int count = 256;
+	auto env = std::make_shared<VectorEnv<H, W>>(count, bombs, 1);
+	auto actions = std::make_shared<std::vector<Action>>(count*64);
+	auto observations = std::make_shared<std::vector<int8_t>>(count*H*W);
+	auto rewards = std::make_shared<std::vector<float>>(count);
+	auto dones = std::make_shared<std::vector<uint8_t>>(count);
+	auto round = std::make_shared<int>(0);
+
+	std::minstd_rand random(1);
+	for (Action& action : *actions)
+		action = {(int)(random()%H), (int)(random()%W), LEFT};
+
+	benches.push_back({"env/step/" + sizeName(H, W), [=](BenchState& state) {
+		*round = (*round+1)%64;
+		state.start();
+		env->step(actions->data()+*round*count, observations->data(), rewards->data(), dones->data());
+		state.stop();
+		doNotOptimize(observations->data());
+		state.setItems(count);
+	}});
+}
+
+static std::vector<Benchmark> registerBenchmarks() {
+	std::vector<Benchmark> benches;
+
+	//the three standard difficulties at their usual densities, on run-time
+	//and on compile-time dimensions
+	const int standard[][3] = {{9, 9, 10}, {16, 16, 40}, {16, 30, 99}};
+	for (auto& s : standard) {
+		int height = s[0], width = s[1], bombs = s[2];
+		benches.push_back({"initBoard/" + sizeName(height, width) + "/" + std::to_string(bombs), [=](BenchState& state) {
+			Grid<> grid(height, width);
+			std::vector<Cell> cells;
+			grid.allocate(cells, Cell(), Cell::sentinel());
+			state.start();
+			Cell::initBoard(cells, grid, bombs, 1);
+			state.stop();
+			doNotOptimize(cells.data());
+			state.setItems(height*width);
+		}});
+	}
+	//grading a board for 3BV, openings, islands and guessing, generation
+	//included. Items are boards
+	for (auto& s : standard) {
+		int height = s[0], width = s[1], bombs = s[2];
+		auto analyzer = std::make_shared<BoardAnalyzer<>>(height, width);
+		benches.push_back({"analyze/" + sizeName(height, width) + "/" + std::to_string(bombs), [=](BenchState& state) {
+			const int boards = 64;
+			int bbbv = 0;
+			state.start();
+			for (int seed = 1; seed <= boards; seed++)
+				bbbv += analyzer->generate(bombs, seed).bbbv;
+			state.stop();
+			doNotOptimize(bbbv);
+			state.setItems(boards);
+		}});
+	}
+	//reading a board file and loading it on a state, and reading a replay of
+	//a move per cell. Items are bytes, to compare with the disk
+	for (auto& s : standard) {
+		int height = s[0], width = s[1], bombs = s[2];
+		benches.push_back({"import/mbf/" + sizeName(height, width) + "/" + std::to_string(bombs), [=](BenchState& state) {
+			BoardState<> board(height, width, bombs, 1);
+			std::string data;
+			writeMbf(board, data);
+			BoardFile file;
+			state.start();
+			for (int i = 0; i < 64; i++) {
+				parseMbf(data.data(), data.size(), file);
+				board.load(file.bombs);
+			}
+			state.stop();
+			doNotOptimize(board.revealed());
+			state.setItems(64*data.size());
+		}});
+		benches.push_back({"import/rawvf/" + sizeName(height, width) + "/" + std::to_string(bombs), [=](BenchState& state) {
+			BoardState<> board(height, width, bombs, 1);
+			std::vector<ReplayEvent> events;
+			for (int idx = 0; idx < height*width; idx++)
+				events.push_back({idx*0.1f, {idx/width, idx%width, LEFT}});
+			std::string data;
+			writeRawvf(board, events, data);
+			Replay replay;
+			state.start();
+			for (int i = 0; i < 16; i++)
+				parseRawvf(data.data(), data.size(), replay);
+			state.stop();
+			doNotOptimize(replay.events.size());
+			state.setItems(16*data.size());
+		}});
+	}
+	addFixedInitBoard<9, 9>(benches, BEGINNER_BOMBS);
+	addFixedInitBoard<16, 16>(benches, INTERMEDIATE_BOMBS);
+	addFixedInitBoard<16, 30>(benches, EXPERT_BOMBS);
+
+	const Size large[] = {{100, 100, "100x100"}, {1000, 1000, "1000x1000"}};
+	const double densities[] = {0.05, 0.15, 0.25};
+	for (const Size& s : large)
+		for (double density : densities) {
+			int height = s.height, width = s.width, bombs = (int)(density*height*width);
+			benches.push_back({"initBoard/" + std::string(s.label) + "/d" + std::to_string((int)(density*100)), [=](BenchState& state) {
+				Grid<> grid(height, width);
+				std::vector<Cell> cells;
+			grid.allocate(cells, Cell(), Cell::sentinel());
+				state.start();
+				Cell::initBoard(cells, grid, bombs, 1);
+				state.stop();
+				doNotOptimize(cells.data());
+				state.setItems(height*width);
+			}});
+		}
+
+	//worst case opening: no bombs at all, so one click reveals every cell
+	const Size openings[] = {{16, 30, "30x16"}, {100, 100, "100x100"}, {1000, 1000, "1000x1000"}};
+	for (const Size& s : openings) {
+		int height = s.height, width = s.width;
+		benches.push_back({"openFreeSpace/empty/" + std::string(s.label), [=](BenchState& state) {
+			Board<> board(height, width, 0);
+			state.start();
+			board.explore(0, 0);
+			state.stop();
+			state.setItems(height*width);
+		}});
+	}
+	addFixedOpening<16, 30>(benches);
+
+	//a realistic sparse board, clicking the first opening found
+	for (const Size& s : openings) {
+		int height = s.height, width = s.width;
+		auto seed = std::make_shared<unsigned>(0);
+		benches.push_back({"openFreeSpace/d5/" + std::string(s.label), [=](BenchState& state) {
+			Board<> board(height, width, height*width/20, 1+(*seed)++%BENCH_SEEDS);
+			std::pair<int, int> start = findOpening(board);
+			if(start.first < 0) {
+				state.skip("a board has no opening");
+				return;
+			}
+			state.start();
+			board.explore(start.first, start.second);
+			state.stop();
+			state.setItems(board._state.revealed());
+		}});
+	}
+
+	//the same opening on a state keeping its frontier up to date, and one solver
+	//move that only has to look at the constraint cells
+	for (const Size& s : openings) {
+		int height = s.height, width = s.width;
+		auto seed = std::make_shared<unsigned>(0);
+		benches.push_back({"frontier/explore/d5/" + std::string(s.label), [=](BenchState& state) {
+			BoardState<> board(height, width, height*width/20, 1+(*seed)++%BENCH_SEEDS);
+			board.trackFrontier(true);
+			std::pair<int, int> start = findOpening(board);
+			if(start.first < 0) {
+				state.skip("a board has no opening");
+				return;
+			}
+			state.start();
+			board.explore(start.first, start.second);
+			state.stop();
+			state.setItems(board.revealed());
+		}});
+
+		auto board = std::make_shared<std::unique_ptr<BoardState<>>>();
+		auto contents = std::make_shared<std::vector<int8_t>>(height*width);
+		auto solver = std::make_shared<SingleCellSolver>(1);
+		benches.push_back({"frontier/single-cell/" + std::string(s.label), [=](BenchState& state) {
+			if(!*board) {
+				board->reset(new BoardState<>(height, width, height*width/10, 1));
+				halfExplore(**board);
+				(*board)->trackFrontier(true);
+				exportContents((*board)->view(), contents->data(), width);
+			}
+			const Frontier<>& frontier = (*board)->frontier();
+			Observation observation = {contents->data(), height, width, height*width/10, &frontier.cells(), &frontier.constraints()};
+			state.start();
+			Action action = solver->nextMove(observation);
+			state.stop();
+			doNotOptimize(action);
+			state.setItems(1);
+		}});
+	}
+
+	for (const Size& s : openings) {
+		int height = s.height, width = s.width;
+		auto board = std::make_shared<std::unique_ptr<Board<>>>();
+		benches.push_back({"endOfGame/" + std::string(s.label), [=](BenchState& state) {
+			if(!*board) {
+				board->reset(new Board<>(height, width, height*width/10));
+				halfExplore(**board);
+			}
+			state.start();
+			for (int i = 0; i < 1000; i++)
+				doNotOptimize((*board)->endOfGame());
+			state.stop();
+			state.setItems(1000);
+		}});
+	}
+
+	addFixedFork<16, 30>(benches);
+	for (const Size& s : openings) {
+		int height = s.height, width = s.width;
+		auto board = std::make_shared<std::unique_ptr<Board<>>>();
+		benches.push_back({"fork/" + std::string(s.label), [=](BenchState& state) {
+			if(!*board) {
+				board->reset(new Board<>(height, width, height*width/10));
+				halfExplore(**board);
+			}
+			state.start();
+			BoardState<> copy = (*board)->fork();
+			state.stop();
+			doNotOptimize(copy.revealed());
+			state.setItems(1);
+		}});
+	}
+
+	//256 boards stepped with random explores; a step is one action on one board
+	addEnvStep<9, 9>(benches, BEGINNER_BOMBS);
+	addEnvStep<16, 30>(benches, EXPERT_BOMBS);
+
+	for (const Size& s : openings) {
+		int height = s.height, width = s.width;
+		auto board = std::make_shared<std::unique_ptr<Board<>>>();
+		auto out = std::make_shared<std::vector<float>>(OBSERVATION_CODES*height*width);
+		benches.push_back({"export/contents/" + std::string(s.label), [=](BenchState& state) {
+			if(!*board) {
+				board->reset(new Board<>(height, width, height*width*15/100));
+				halfExplore(**board);
+			}
+			int8_t* dst = reinterpret_cast<int8_t*>(out->data());
+			state.start();
+			exportContents((*board)->view(), dst, width);
+			state.stop();
+			doNotOptimize(dst);
+			state.setItems(height*width);
+		}});
+		benches.push_back({"export/oneHot/" + std::string(s.label), [=](BenchState& state) {
+			if(!*board) {
+				board->reset(new Board<>(height, width, height*width*15/100));
+				halfExplore(**board);
+			}
+			state.start();
+			exportOneHot((*board)->view(), out->data(), height*width, width);
+			state.stop();
+			doNotOptimize(out->data());
+			state.setItems(height*width);
+		}});
+	}
+
+	//one move of the reference solver on a half explored board
+	for (const Size& s : openings) {
+		int height = s.height, width = s.width;
+		auto board = std::make_shared<std::unique_ptr<Board<>>>();
+		auto contents = std::make_shared<std::vector<int8_t>>(height*width);
+		auto solver = std::make_shared<SingleCellSolver>(1);
+		benches.push_back({"solver/single-cell/" + std::string(s.label), [=](BenchState& state) {
+			if(!*board) {
+				board->reset(new Board<>(height, width, height*width/10));
+				halfExplore(**board);
+				exportContents((*board)->view(), contents->data(), width);
+			}
+			Observation observation = {contents->data(), height, width, height*width/10, nullptr, nullptr};
+			state.start();
+			Action action = solver->nextMove(observation);
+			state.stop();
+			doNotOptimize(action);
+			state.setItems(1);
+		}});
+	}
+
+	//the probabilities of every cell of a board 20% bombs, with an empty
+	//component cache and no sampling: the enumeration and the combination of
+	//the components
+	{
+		const int height = 100, width = 100, bombs = height*width/5;
+		auto board = std::make_shared<std::unique_ptr<Board<>>>();
+		auto contents = std::make_shared<std::vector<int8_t>>(height*width);
+		auto probabilities = std::make_shared<std::vector<float>>();
+		benches.push_back({"probability/exact/100x100", [=](BenchState& state) {
+			if(!*board) {
+				board->reset(new Board<>(height, width, bombs));
+				scatterExplore(**board);
+				exportContents((*board)->view(), contents->data(), width);
+			}
+			Observation observation = {contents->data(), height, width, bombs, nullptr, nullptr};
+			ComponentCache cache;
+			ProbabilityEngine engine(cache);
+			engine.setSampling(1, Clock::duration::zero());
+			state.start();
+			engine.compute(observation, *probabilities);
+			state.stop();
+			doNotOptimize(probabilities->data());
+			state.setItems(1);
+		}});
+	}
+
+	//whole expert games on the same seeds: the single-cell strategy one board
+	//at a time and BITSLICED_LANES at a time, the pattern, the elimination,
+	//the probability, the lookahead and the endgame solvers. Items are games
+	{
+		const int games = 256;
+		auto seeds = std::make_shared<std::vector<unsigned>>(games);
+		std::minstd_rand random(1);
+		for (unsigned& seed : *seeds)
+			seed = random();
+
+		auto contents = std::make_shared<std::vector<int8_t>>(16*30);
+		auto addGames = [&](const char* name, SolverFactory create) {
+			benches.push_back({"games/" + std::string(name) + "/expert", [=](BenchState& state) {
+				Observation observation = {contents->data(), 16, 30, EXPERT_BOMBS, nullptr, nullptr};
+				int won = 0;
+				state.start();
+				for (unsigned seed : *seeds) {
+					BoardState<16, 30> board(EXPERT_BOMBS, seed);
+					std::unique_ptr<Solver> solver = create(seed);
+					solver->newGame(16, 30, EXPERT_BOMBS);
+					while(!board.endOfGame()) {
+						exportContents(board.view(), contents->data(), 30);
+						board.apply(solver->nextMove(observation));
+					}
+					won += board.won();
+				}
+				state.stop();
+				doNotOptimize(won);
+				state.setItems(games);
+			}});
+		};
+		addGames("single-cell", [](unsigned seed) { return std::unique_ptr<Solver>(new SingleCellSolver(seed)); });
+		addGames("patterns", [](unsigned seed) { return std::unique_ptr<Solver>(new PatternSolver(seed)); });
+		addGames("elimination", [](unsigned seed) { return std::unique_ptr<Solver>(new EliminationSolver(seed)); });
+		addGames("probability", [](unsigned seed) { return std::unique_ptr<Solver>(new ProbabilitySolver(seed)); });
+		addGames("lookahead", [](unsigned seed) { return std::unique_ptr<Solver>(new LookaheadSolver(seed)); });
+		addGames("endgame", [](unsigned seed) { return std::unique_ptr<Solver>(new EndgameSolver(seed)); });
+
+		auto solver = std::make_shared<BitslicedSolver<16, 30>>(EXPERT_BOMBS);
+		auto results = std::make_shared<std::vector<BitslicedResult>>(games);
+		benches.push_back({"games/bitsliced/expert", [=](BenchState& state) {
+			state.start();
+			solver->play(seeds->data(), games, results->data());
+			state.stop();
+			doNotOptimize(results->data());
+			state.setItems(games);
+		}});
+	}
+
+	const Size renders[] = {{16, 30, "30x16"}, {100, 100, "100x100"}, {1000, 1000, "1000x1000"}};
+	for (const Size& s : renders) {
+		int height = s.height, width = s.width;
+		auto board = std::make_shared<std::unique_ptr<Board<>>>();
+		auto gui = std::make_shared<Gui>(height, width);
+		benches.push_back({"drawBoard/vertices/" + std::string(s.label), [=](BenchState& state) {
+			if(!*board) {
+				board->reset(new Board<>(height, width, height*width*15/100));
+				halfExplore(**board);
+			}
+			state.start();
+			doNotOptimize(gui->buildBoard((*board)->view()).size());
+			state.stop();
+			state.setItems(height*width);
+		}});
+	}
+
+	return benches;
+}
+
+/*************************************************************************
+Reporting
+*************************************************************************/
+
+static void writeJson(std::ostream& out, const std::vector<BenchResult>& results) {
+	out.precision(10);
+	out << "{\n  \"benchmarks\": [\n";
+	for (size_t i = 0; i < results.size(); i++)
+		out << "    {\"name\": \"" << results[i].name << "\", \"ns_per_op\": " << results[i].ns_per_op
+			<< ", \"items_per_sec\": " << results[i].items_per_sec
+			<< ", \"iterations\": " << results[i].iterations << "}"
+			<< (i+1 < results.size() ? "," : "") << "\n";
+	out << "  ]\n}\n";
+}
+
+//reads back the name and ns_per_op of every entry of a file written by
+//writeJson. This is not a general JSON parser
+static std::map<std::string, double> readBaseline(const char* path) {
+	std::map<std::string, double> baseline;
+	std::ifstream in(path);
+	std::string line;
+
+	while(std::getline(in, line)) {
+		size_t name = line.find("\"name\": \"");
+		size_t ns = line.find("\"ns_per_op\": ");
+		if(name == std::string::npos || ns == std::string::npos)
+			continue;
+		name += 9;
+		baseline[line.substr(name, line.find('"', name)-name)] = std::atof(line.c_str()+ns+13);
+	}
+	return baseline;
+}
+
+int main(int argc, char** argv) {
+	const char* filter = "";
+	const char* json = nullptr;
+	const char* baseline_path = nullptr;
+	double min_time = 0.5, threshold = 10;
+
+	for (int i = 1; i < argc; i++) {
+		if(!std::strcmp(argv[i], "--filter") && i+1 < argc)
+			filter = argv[++i];
+		else if(!std::strcmp(argv[i], "--min-time") && i+1 < argc)
+			min_time = std::atof(argv[++i]);
+		else if(!std::strcmp(argv[i], "--json") && i+1 < argc)
+			json = argv[++i];
+		else if(!std::strcmp(argv[i], "--baseline") && i+1 < argc)
+			baseline_path = argv[++i];
+		else if(!std::strcmp(argv[i], "--threshold") && i+1 < argc)
+			threshold = std::atof(argv[++i]);
+		else {
+			std::cerr << "usage: " << argv[0] << " [--filter TEXT] [--min-time SECONDS] [--json FILE] [--baseline FILE] [--threshold PERCENT]" << std::endl;
+			return 2;
+		}
+	}
+
+	std::map<std::string, double> baseline;
+	if(baseline_path)
+		baseline = readBaseline(baseline_path);
+
+	std::vector<BenchResult> results;
+	bool regressed = false;
+
+	for (const Benchmark& bench : registerBenchmarks()) {
+		if(bench.name.find(filter) == std::string::npos)
+			continue;
+
+		BenchResult result = runBenchmark(bench, min_time);
+		if(result.skipped) {
+			std::printf("%-40s skipped: %s\n", result.name.c_str(), result.skipped);
+			continue;
+		}
+		results.push_back(result);
+
+		std::printf("%-40s %14.1f ns/op %14.0f items/s", result.name.c_str(), result.ns_per_op, result.items_per_sec);
+		auto base = baseline.find(result.name);
+		if(base != baseline.end() && base->second > 0) {
+			double change = 100*(result.ns_per_op-base->second)/base->second;
+			std::printf(" %+7.1f%%%s", change, change > threshold ? " REGRESSION" : "");
+			regressed |= change > threshold;
+		}
+		std::printf("\n");
+		std::fflush(stdout);
+	}
+
+	if(json && !std::strcmp(json, "-"))
+		writeJson(std::cout, results);
+	else if(json) {
+		std::ofstream out(json);
+		writeJson(out, results);
+	}
+
+	return regressed ? 1 : 0;
+}
@@ -0,0 +1,111 @@
+#include "minesweeper_c.h"
+#include "environment.h"
+#include "observation.h"
+
+static_assert(MINESWEEPER_FLAG == RIGHT && MINESWEEPER_EXPLORE == LEFT && MINESWEEPER_CHORD == MIDDLE, "C buttons out of step with MouseButton");
+static_assert(MINESWEEPER_CODES == OBSERVATION_CODES && -FLAGGED == 3, "C codes out of step with observation.h");
+
+struct minesweeper_env {
+	VectorEnv<> env;
+	//converted C actions, kept so a step does not allocate
+	std::vector<Action> actions;
+};
+
+//runs f, turning any exception into error so none crosses the C interface
+template <typename R, typename F>
+static R guarded(R error, F f) {
+	try {
+		return f();
+	}
+	catch (...) {
+		return error;
+	}
+}
+
+//runs f the same way, for the functions returning 0 or -1
+template <typename F>
+static int guardedStatus(F f) {
+	return guarded(-1, [&] {
+		f();
+		return 0;
+	});
+}
+
+//a C action as the engine plays it. Any button but the three of the C
+//interface becomes an action outside the board, which changes nothing
+static Action toAction(const minesweeper_action& action) {
+	if(action.button < MINESWEEPER_FLAG || action.button > MINESWEEPER_CHORD)
+		return {-1, -1, LEFT};
+	return {action.row, action.col, (MouseButton)action.button};
+}
+
+minesweeper_env* minesweeper_env_create(int count, int height, int width, int bombs, unsigned seed) {
+	if(count <= 0 || height <= 0 || width <= 0 || bombs < 0 || bombs >= height*width)
+		return nullptr;
+	return guarded<minesweeper_env*>(nullptr, [&] {
+		return new minesweeper_env{VectorEnv<>(count, height, width, bombs, seed), std::vector<Action>(count)};
+	});
+}
+
+void minesweeper_env_destroy(minesweeper_env* env) {
+	delete env;
+}
+
+int minesweeper_env_size(const minesweeper_env* env) {
+	return guarded(-1, [&] { return env->env.size(); });
+}
+
+int minesweeper_env_height(const minesweeper_env* env) {
+	return guarded(-1, [&] { return env->env.board(0).height(); });
+}
+
+int minesweeper_env_width(const minesweeper_env* env) {
+	return guarded(-1, [&] { return env->env.board(0).width(); });
+}
+
+int minesweeper_env_reset(minesweeper_env* env) {
+	return guardedStatus([&] { env->env.reset(nullptr); });
+}
+
+int minesweeper_env_step(minesweeper_env* env, const minesweeper_action* actions, float* rewards, uint8_t* dones) {
+	return guardedStatus([&] {
+		for (int i = 0; i < env->env.size(); i++)
+			env->actions[i] = toAction(actions[i]);
+		env->env.step(env->actions.data(), nullptr, rewards, dones);
+	});
+}
+
+int minesweeper_env_contents(const minesweeper_env* env, int8_t* out, ptrdiff_t board_stride, ptrdiff_t row_stride) {
+	return guardedStatus([&] {
+		for (int i = 0; i < env->env.size(); i++)
+			exportContents(env->env.board(i).view(), out+i*board_stride, row_stride);
+	});
+}
+
+int minesweeper_env_codes(const minesweeper_env* env, uint8_t* out, ptrdiff_t board_stride, ptrdiff_t row_stride) {
+	return guardedStatus([&] {
+		for (int i = 0; i < env->env.size(); i++)
+			exportCodes(env->env.board(i).view(), out+i*board_stride, row_stride);
+	});
+}
+
+int minesweeper_env_values(const minesweeper_env* env, float* out, ptrdiff_t board_stride, ptrdiff_t row_stride) {
+	return guardedStatus([&] {
+		for (int i = 0; i < env->env.size(); i++)
+			exportValues(env->env.board(i).view(), out+i*board_stride, row_stride);
+	});
+}
+
+int minesweeper_env_one_hot_u8(const minesweeper_env* env, uint8_t* out, ptrdiff_t board_stride, ptrdiff_t plane_stride, ptrdiff_t row_stride) {
+	return guardedStatus([&] {
+		for (int i = 0; i < env->env.size(); i++)
+			exportOneHot(env->env.board(i).view(), out+i*board_stride, plane_stride, row_stride);
+	});
+}
+
+int minesweeper_env_one_hot_f32(const minesweeper_env* env, float* out, ptrdiff_t board_stride, ptrdiff_t plane_stride, ptrdiff_t row_stride) {
+	return guardedStatus([&] {
+		for (int i = 0; i < env->env.size(); i++)
+			exportOneHot(env->env.board(i).view(), out+i*board_stride, plane_stride, row_stride);
+	});
+}
@@ -0,0 +1,135 @@
+#pragma once
+
+#include <random>
+#include <vector>
+#include "def.h"
+#include "solver.h"
+
+/*
+classes RandomSolver and SingleCellSolver are defined in this file
+
+They are the reference strategies every other solver is measured against.
+
+	RandomSolver --> explores an unexplored cell at random. The floor of the
+				tournament.
+
+	SingleCellSolver --> looks at one revealed number at a time. If all its
+				bombs are already flagged, the rest of its neighbours are
+				safe and it chords them; if its unexplored neighbours are
+				exactly its missing bombs, it flags one of them. When no
+				number allows a move, it explores a random unexplored cell.
+				Only the constraint cells are looked at when the observation
+				comes with them.
+*/
+class RandomSolver : public Solver
+{
+public:
+	explicit RandomSolver(unsigned seed);
+
+	const char* name() const override { return "random"; }
+	Action nextMove(const Observation& board) override;
+
+protected:
+	virtual Action guess(const Observation& board);
+
+	std::minstd_rand _random;
+	std::vector<int> _candidates;
+};
+
+class SingleCellSolver : public RandomSolver
+{
+public:
+	explicit SingleCellSolver(unsigned seed) : RandomSolver(seed) {}
+
+	const char* name() const override { return "single-cell"; }
+	Action nextMove(const Observation& board) override;
+
+protected:
+	bool deduce(const Observation& board, Action& action) const;
+
+private:
+	bool deduce(const Observation& board, int row, int col, Action& action) const;
+};
+
+inline void registerBasicSolvers() {
+	registerSolver("random", [](unsigned seed) { return std::unique_ptr<Solver>(new RandomSolver(seed)); });
+	registerSolver("single-cell", [](unsigned seed) { return std::unique_ptr<Solver>(new SingleCellSolver(seed)); });
+}
+
+
+//the tournament hands the seed of a board to the solver playing it, so the
+//seed is mixed first: Cell::initBoard draws the bombs from minstd_rand(seed)
+inline RandomSolver::RandomSolver(unsigned seed) {
+	std::seed_seq sequence = {seed};
+	_random.seed(sequence);
+}
+
+//explores one of the unexplored cells, all equally likely
+inline Action RandomSolver::guess(const Observation& board) {
+	_candidates.clear();
+	for (int idx = 0; idx < board.height*board.width; idx++)
+		if(board.contents[idx] == UNEXPLORED)
+			_candidates.push_back(idx);
+
+	if(_candidates.empty())
+		return {-1, -1, LEFT};
+	int idx = _candidates[_random()%_candidates.size()];
+	return {idx/board.width, idx%board.width, LEFT};
+}
+
+inline Action RandomSolver::nextMove(const Observation& board) {
+	return guess(board);
+}
+
+//finds the move the number at (row, col) allows on its own, if any
+inline bool SingleCellSolver::deduce(const Observation& board, int row, int col, Action& action) const {
+	int number = board.at(row, col);
+	if(number <= 0)
+		return false;
+
+	int unexplored = 0, flagged = 0, first_row = 0, first_col = 0;
+	for (int i = row-1; i <= row+1; i++)
+		for (int j = col-1; j <= col+1; j++) {
+			if(i < 0 || i >= board.height || j < 0 || j >= board.width)
+				continue;
+			int content = board.at(i, j);
+			flagged += content == FLAGGED;
+			if(content == UNEXPLORED && unexplored++ == 0) {
+				first_row = i;
+				first_col = j;
+			}
+		}
+
+	if(unexplored == 0)
+		return false;
+	if(flagged == number)
+		action = {row, col, MIDDLE};
+	else if(flagged+unexplored == number)
+		action = {first_row, first_col, RIGHT};
+	else
+		return false;
+	return true;
+}
+
+//finds a move one of the numbers allows on its own, if any
+inline bool SingleCellSolver::deduce(const Observation& board, Action& action) const {
+	if(board.constraints) {
+		for (int idx : *board.constraints)
+			if(deduce(board, board.row(idx), board.col(idx), action))
+				return true;
+		return false;
+	}
+
+	for (int row = 0; row < board.height; row++)
+		for (int col = 0; col < board.width; col++)
+			if(deduce(board, row, col, action))
+				return true;
+	return false;
+}
+
+inline Action SingleCellSolver::nextMove(const Observation& board) {
+	Action action;
+	if(deduce(board, action))
+		return action;
+	return guess(board);
+}
@@ -0,0 +1,356 @@
+#pragma once
+
+#include <cstdint>
+#include <random>
+#include <vector>
+#include "def.h"
+#include "cell.h"
+#include "grid.h"
+#include "profiler.h"
+
+/*
+class BitslicedSolver is defined in this file
+
+BitslicedSolver<H, W> plays BITSLICED_LANES games at once with the strategy
+of SingleCellSolver (see basic_solvers.h), for simulations that only need
+the outcome of many games. Instead of one board per object, it keeps one
+word per cell of the padded storage (see grid.h) for each property of a
+cell, and bit k of every word belongs to game k, its lane:
+
+	bomb, number --> the layout, from the same Cell::initBoard as every
+				other board, so a seed gives the same game as
+				BoardState(seed). The number of bombs around a cell is
+				stored as 4 words, one per bit.
+
+	covered, flagged --> what the player has done so far. A cell of a lane
+				that is neither covered nor flagged is explored.
+
+	open --> explored cells with no bombs around them: their covered
+				neighbours are explored by the cascade.
+
+Counting the covered and the flagged neighbours of a cell, comparing them to
+its number and spreading the result to the neighbours are then a few dozen
+bitwise operations for all the lanes together. Every step, each lane either
+applies every move its numbers allow on their own (all the chords and all
+the flags SingleCellSolver would find one by one) or, if there is none,
+explores a random covered cell. The cascade is a fixpoint over the board,
+swept forward and backward until no lane changes. Sentinels hold no bits at
+all, so neighbour loops need no tests here either.
+
+A lane whose game is over is loaded with the next game right away, so all
+the lanes stay busy until the last games. Guesses use a generator seeded
+from the seed of the game, so results do not depend on which lane or which
+batch a game was played in.
+*/
+#define BITSLICED_LANES 64
+
+struct BitslicedResult {
+	bool won;
+	int steps;
+};
+
+template <int H = 0, int W = 0>
+class BitslicedSolver
+{
+public:
+	typedef uint64_t Lanes;
+	typedef typename Grid<H, W>::template Array<Lanes> Plane;
+
+	BitslicedSolver(int height, int width, int bomb_cnt);
+	explicit BitslicedSolver(int bomb_cnt);
+
+	int height() const { return _grid.height(); }
+	int width() const { return _grid.width(); }
+
+	void play(const unsigned* seeds, int games, BitslicedResult* results);
+	void observe(int lane, int8_t* contents) const;
+
+private:
+	//a number from 0 to 15 in every lane, one word per bit
+	struct Nibbles {
+		Lanes bit[4];
+	};
+
+	void load(int lane, unsigned seed);
+	Nibbles count(const Plane& plane, int idx) const;
+	Lanes deduce();
+	void guess(Lanes lanes);
+	void explore(int idx, Lanes lanes);
+	Lanes cascade();
+
+	static Nibbles add(const Nibbles& a, const Nibbles& b);
+	static Lanes equal(const Nibbles& a, const Nibbles& b);
+
+	Grid<H, W> _grid;
+	int _bomb_cnt;
+
+	Plane _bomb;
+	Plane _number[4];
+	Plane _covered;
+	Plane _flagged;
+	Plane _open;
+	Plane _safe;
+	Plane _mine;
+
+	//per lane: the game it is playing, when it started and its guesses
+	Lanes _active, _lost;
+	int _game[BITSLICED_LANES];
+	int _start[BITSLICED_LANES];
+	std::minstd_rand _random[BITSLICED_LANES];
+	typename Grid<H, W>::template Array<Cell> _layout;
+};
+
+
+template <int H, int W>
+BitslicedSolver<H, W>::BitslicedSolver(int height, int width, int bomb_cnt) : _grid(height, width),
+																			_bomb_cnt(bomb_cnt),
+																			_active(0),
+																			_lost(0) {
+	_grid.allocate(_bomb, Lanes(0), Lanes(0));
+	for (Plane& plane : _number)
+		_grid.allocate(plane, Lanes(0), Lanes(0));
+	_grid.allocate(_covered, Lanes(0), Lanes(0));
+	_grid.allocate(_flagged, Lanes(0), Lanes(0));
+	_grid.allocate(_open, Lanes(0), Lanes(0));
+	_grid.allocate(_safe, Lanes(0), Lanes(0));
+	_grid.allocate(_mine, Lanes(0), Lanes(0));
+}
+
+//fixed size boards only
+template <int H, int W>
+BitslicedSolver<H, W>::BitslicedSolver(int bomb_cnt) : BitslicedSolver(H, W, bomb_cnt) {
+	static_assert(H > 0 && W > 0, "BitslicedSolver<>(bomb_cnt) needs the dimensions, use BitslicedSolver<>(height, width, bomb_cnt)");
+}
+
+//plays the games seeds[0..games) to the end and writes the outcome of game i
+//to results[i]. A step is one round of deductions or one guess
+template <int H, int W>
+void BitslicedSolver<H, W>::play(const unsigned* seeds, int games, BitslicedResult* results) {
+	PROFILE_SCOPE("BitslicedSolver::play");
+	int next = 0, step = 0;
+	_active = 0;
+	for (int lane = 0; lane < BITSLICED_LANES && next < games; lane++) {
+		load(lane, seeds[next]);
+		_game[lane] = next++;
+		_start[lane] = 0;
+		_active |= Lanes(1) << lane;
+	}
+
+	while(_active) {
+		Lanes stuck = _active & ~deduce();
+		guess(stuck);
+		Lanes remaining = cascade();
+		step++;
+
+		Lanes finished = _active & (_lost | ~remaining);
+		for (int lane = 0; lane < BITSLICED_LANES; lane++) {
+			Lanes bit = Lanes(1) << lane;
+			if(!(finished & bit))
+				continue;
+			results[_game[lane]] = {!(_lost & bit), step-_start[lane]};
+
+			if(next < games) {
+				load(lane, seeds[next]);
+				_game[lane] = next++;
+				_start[lane] = step;
+			}
+			else
+				_active &= ~bit;
+		}
+	}
+}
+
+//writes what the player sees of the board of lane, row by row, with the
+//values of Cell::getContent (see observation.h)
+template <int H, int W>
+void BitslicedSolver<H, W>::observe(int lane, int8_t* contents) const {
+	Lanes bit = Lanes(1) << lane;
+	_grid.forEachCell([&](int idx) {
+		int8_t content;
+		if(_covered[idx] & bit)
+			content = UNEXPLORED;
+		else if(_flagged[idx] & bit)
+			content = FLAGGED;
+		else if(_bomb[idx] & bit)
+			content = BOMB;
+		else
+			content = !!(_number[0][idx] & bit) | !!(_number[1][idx] & bit) << 1 | !!(_number[2][idx] & bit) << 2 | !!(_number[3][idx] & bit) << 3;
+		*contents++ = content;
+	});
+}
+
+//starts the game of seed in lane, every cell covered
+template <int H, int W>
+void BitslicedSolver<H, W>::load(int lane, unsigned seed) {
+	Lanes bit = Lanes(1) << lane;
+	_grid.allocate(_layout, Cell(), Cell::sentinel());
+	Cell::initBoard(_layout, _grid, _bomb_cnt, seed);
+
+	_grid.forEachCell([&](int idx) {
+		Cell cell = _layout[idx];
+		cell.setVisibility(FREE);
+		int content = cell.getContent();
+		Lanes bomb = content == BOMB;
+		int number = content == BOMB ? 0 : content;
+
+		_bomb[idx] = (_bomb[idx] & ~bit) | bomb << lane;
+		for (int b = 0; b < 4; b++)
+			_number[b][idx] = (_number[b][idx] & ~bit) | Lanes(number >> b & 1) << lane;
+		_covered[idx] |= bit;
+		_flagged[idx] &= ~bit;
+		_open[idx] &= ~bit;
+	});
+	_lost &= ~bit;
+
+	//seeded with seed itself, it would draw the bombs of initBoard again
+	std::seed_seq sequence = {seed};
+	_random[lane].seed(sequence);
+}
+
+//counts the neighbours of idx that are set in plane, lane by lane, with a
+//carry-save adder tree: 8 inputs give a sum from 0 to 8
+template <int H, int W>
+typename BitslicedSolver<H, W>::Nibbles BitslicedSolver<H, W>::count(const Plane& plane, int idx) const {
+	Lanes x[8];
+	for (int k = 0; k < 8; k++)
+		x[k] = plane[idx+_grid.OFFSETS[k]];
+
+	Lanes s1 = x[0]^x[1]^x[2], c1 = (x[0] & x[1]) | (x[2] & (x[0]^x[1]));
+	Lanes s2 = x[3]^x[4]^x[5], c2 = (x[3] & x[4]) | (x[5] & (x[3]^x[4]));
+	Lanes s3 = x[6]^x[7], c3 = x[6] & x[7];
+	Lanes ones = s1^s2^s3, c4 = (s1 & s2) | (s3 & (s1^s2));
+	Lanes t = c1^c2^c3, d1 = (c1 & c2) | (c3 & (c1^c2));
+	Lanes twos = t^c4, d2 = t & c4;
+	return {{ones, twos, d1^d2, d1 & d2}};
+}
+
+template <int H, int W>
+typename BitslicedSolver<H, W>::Nibbles BitslicedSolver<H, W>::add(const Nibbles& a, const Nibbles& b) {
+	Nibbles sum;
+	Lanes carry = 0;
+	for (int k = 0; k < 4; k++) {
+		sum.bit[k] = a.bit[k]^b.bit[k]^carry;
+		carry = (a.bit[k] & b.bit[k]) | (carry & (a.bit[k]^b.bit[k]));
+	}
+	return sum;
+}
+
+template <int H, int W>
+typename BitslicedSolver<H, W>::Lanes BitslicedSolver<H, W>::equal(const Nibbles& a, const Nibbles& b) {
+	return ~((a.bit[0]^b.bit[0]) | (a.bit[1]^b.bit[1]) | (a.bit[2]^b.bit[2]) | (a.bit[3]^b.bit[3]));
+}
+
+//applies, in every active lane, every move its explored numbers allow on
+//their own: a number with all its bombs flagged makes its covered neighbours
+//safe, a number with as many covered neighbours as missing bombs makes them
+//bombs. Returns the lanes where something was explored or flagged
+template <int H, int W>
+typename BitslicedSolver<H, W>::Lanes BitslicedSolver<H, W>::deduce() {
+	_grid.forEachCell([&](int idx) {
+		Lanes explored = _active & ~(_covered[idx] | _flagged[idx] | _bomb[idx]);
+		if(!explored)
+			return;
+
+		Nibbles covered = count(_covered, idx);
+		Nibbles flagged = count(_flagged, idx);
+		Nibbles number = {{_number[0][idx], _number[1][idx], _number[2][idx], _number[3][idx]}};
+		explored &= covered.bit[0] | covered.bit[1] | covered.bit[2] | covered.bit[3];
+		if(!explored)
+			return;
+
+		Lanes safe = explored & equal(number, flagged);
+		Lanes mine = explored & equal(number, add(flagged, covered));
+		if(safe | mine)
+			_grid.forEachNeighbour(idx, [&](int n) {
+				_safe[n] |= safe;
+				_mine[n] |= mine;
+			});
+	});
+
+	//the planes are cleared as they are read, ready for the next step. What
+	//lands on the sentinels is never read
+	Lanes progress = 0;
+	_grid.forEachCell([&](int idx) {
+		Lanes safe = _safe[idx] & _covered[idx];
+		Lanes mine = _mine[idx] & _covered[idx];
+		_safe[idx] = 0;
+		_mine[idx] = 0;
+		if(!(safe | mine))
+			return;
+		_flagged[idx] |= mine;
+		_covered[idx] &= ~mine;
+		explore(idx, safe);
+		progress |= safe | mine;
+	});
+	return progress;
+}
+
+//explores a covered cell chosen at random in each of lanes, all cells
+//equally likely. Most boards are mostly covered, so a few random draws are
+//enough; the scan is for the rare board with almost none left
+template <int H, int W>
+void BitslicedSolver<H, W>::guess(Lanes lanes) {
+	for (int lane = 0; lane < BITSLICED_LANES; lane++) {
+		Lanes bit = Lanes(1) << lane;
+		if(!(lanes & bit))
+			continue;
+
+		std::minstd_rand& random = _random[lane];
+		int idx = -1;
+		for (int attempt = 0; attempt < 32 && idx < 0; attempt++) {
+			int candidate = _grid.index(random()%height(), random()%width());
+			if(_covered[candidate] & bit)
+				idx = candidate;
+		}
+		if(idx < 0) {
+			int covered = 0;
+			_grid.forEachCell([&](int i) { covered += !!(_covered[i] & bit); });
+			if(covered == 0)
+				continue;
+			int pick = random()%covered;
+			_grid.forEachCell([&](int i) {
+				if((_covered[i] & bit) && pick-- == 0)
+					idx = i;
+			});
+		}
+		explore(idx, bit);
+	}
+}
+
+//uncovers idx in lanes. A bomb loses the game of its lane
+template <int H, int W>
+void BitslicedSolver<H, W>::explore(int idx, Lanes lanes) {
+	_covered[idx] &= ~lanes;
+	_lost |= lanes & _bomb[idx];
+	_open[idx] |= lanes & ~(_bomb[idx] | _number[0][idx] | _number[1][idx] | _number[2][idx] | _number[3][idx]);
+}
+
+//explores every covered cell next to an open cell, in every lane, until there
+//is none left. Returns the lanes that still have a covered safe cell
+template <int H, int W>
+typename BitslicedSolver<H, W>::Lanes BitslicedSolver<H, W>::cascade() {
+	int first = _grid.index(0, 0), last = _grid.index(height()-1, width()-1);
+	Lanes changed, remaining;
+	bool forward = true;
+
+	do {
+		changed = 0;
+		remaining = 0;
+		for (int i = first; i <= last; i++) {
+			int idx = forward ? i : first+last-i;
+			Lanes covered = _covered[idx];
+			if(covered) {
+				Lanes open = 0;
+				for (int k = 0; k < 8; k++)
+					open |= _open[idx+_grid.OFFSETS[k]];
+				if(covered & open) {
+					explore(idx, covered & open);
+					changed |= covered & open;
+				}
+			}
+			remaining |= _covered[idx] & ~_bomb[idx];
+		}
+		forward = !forward;
+	} while(changed);
+	return remaining;
+}
@@ -3,25 +3,113 @@
 #include <cstdlib>
 #include <GLFW/glfw3.h>
 #include <cmath>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <fstream>
+#include <iostream>
+#include <thread>
 #include "def.h"
 #include "gui.h"
+#include "channel.h"
+#include "snapshot.h"
+#include "latency.h"
+#include "profiler.h"
+#include "grid.h"
+#include "history.h"
+#include "board_state.h"
+#include "observation.h"
+#include "basic_solvers.h"
+#include "endgame_solver.h"
 
+//how long the logic thread may keep working on a cascade before handing an
+//intermediate snapshot to the render thread
+#define PUBLISH_INTERVAL_MS 16
+//pace of the automatic player, so its game can be followed on screen
+#define SOLVER_MOVE_MS 100
+//how long the automatic player may search for the best guess of a move
+#define SOLVER_THINK_MS 50
+//how often the automatic player checks whether it may make its next move
+#define SOLVER_POLL_MS 1
+
+//a snapshot of the board handed to the render thread. Only the visibility is
+//copied, the layout never changes and is shared with the board. seq increases
+//with every publish so moves can be matched with the first frame showing them
+struct Frame {
+	std::vector<Visibility> visibility;
+	std::shared_ptr<const Cell> layout;
+	int height, width;
+	unsigned seq;
+
+	BoardView view() const { return {layout.get(), visibility.data(), height, width, width+2}; }
+};
+
+/*
+Board<H, W> is a game on an H x W grid. Board<> (the default) takes its
+dimensions at run time; giving them as template arguments selects a fixed
+size Grid (see grid.h) with compile-time neighbour offsets and std::array
+storage. The standard difficulties have their own names below.
+
+The rules themselves live in BoardState (see board_state.h); Board adds the
+window, the threads, undo history and latency tracking around it.
+*/
+template <int H = 0, int W = 0>
 class Board
 {
 public:
-	Board(int, int, int);
+	Board(int, int, int, unsigned seed = std::random_device()());
+	explicit Board(int, unsigned seed = std::random_device()());
 	void run();
 
-	int _height, _width, _bomb_cnt;
-	std::vector<std::vector<Cell>> _cells;
+	int height() const { return _state.height(); }
+	int width() const { return _state.width(); }
+	Cell cell(int row, int col) const { return _state.cell(row, col); }
+	BoardView view() const { return _state.view(); }
+	BoardState<H, W> fork() const { return _state.fork(); }
+
+	Visibility explore(int row, int col);
+	bool toggleFlag(int row, int col);
+	bool chord(int row, int col);
+	bool undo();
+	bool redo();
+	void recordHistory(bool on);
+	bool endOfGame() const;
+	bool won() const;
+	bool lost() const;
+
+	BoardState<H, W> _state;
 
 private:
 	Gui _gui;
-	void openFreeSpace(int row, int col);
-	bool endOfGame();
+	History _history;
+
+	static void progress(void* board);
 
+	void logicLoop();
+	void autoPlayLoop();
+	void play(Move move);
+	void applyMove(const Move& move);
+	void publish();
+	void recordLatency(unsigned seq, Clock::time_point submitted, Clock::time_point presented);
+
+	Channel<Move> _moves;
+	Channel<Move> _applied;
+	TripleBuffer<Frame> _frames;
+	unsigned _seq;
+	//seq of the last frame presented, set by the render thread
+	std::atomic<unsigned> _presented;
+	Clock::time_point _last_publish;
+	std::atomic<bool> _game_over;
+
+	std::deque<Move> _pending_latency;
+	LatencyTracker _latency;
 };
 
+typedef Board<9, 9> BeginnerBoard;
+typedef Board<16, 16> IntermediateBoard;
+typedef Board<16, 30> ExpertBoard;
+
 
 /*************************************************************************
 **************************************************************************
@@ -31,62 +119,240 @@ Board
 **************************************************************************
 *************************************************************************/
 
-Board::Board(int height, int width, int bomb_cnt) : _height(height),
-													_width(width), 
-													_bomb_cnt(bomb_cnt) {
-	_cells.resize(width, std::vector<Cell>(height));
-	Cell::initBoard(_cells, _bomb_cnt);
+template <int H, int W>
+Board<H, W>::Board(int height, int width, int bomb_cnt, unsigned seed) : _state(height, width, bomb_cnt, seed),
+													_seq(0),
+													_presented(0),
+													_game_over(false) {
+	_state.recordTo(&_history);
+	_state.onProgress(&Board<H, W>::progress, this);
+}
+
+//fixed size boards only
+template <int H, int W>
+Board<H, W>::Board(int bomb_cnt, unsigned seed) : Board(H, W, bomb_cnt, seed) {
+	static_assert(H > 0 && W > 0, "Board<>(bomb_cnt) needs the dimensions, use Board<>(height, width, bomb_cnt)");
+}
+
+//called by _state every few thousand steps of a cascade. Publishes an
+//intermediate snapshot so the render thread can show a long reveal while it
+//is in progress
+template <int H, int W>
+void Board<H, W>::progress(void* board) {
+	Board<H, W>* self = static_cast<Board<H, W>*>(board);
+	if(Clock::now() - self->_last_publish >= std::chrono::milliseconds(PUBLISH_INTERVAL_MS))
+		self->publish();
 }
 
-void Board::openFreeSpace(int row, int col) {
-	if(_cells[row][col].getContent() == 0)
-		for (int i = -1; i <= 1; i++)
-			for (int j = -1; j <= 1; j++)
-				if((i!=0||j!=0) && row+i >= 0 && row+i < _height && col+j >= 0 && col+j < _width)
-					if(_cells[row+i][col+j].getVisibility() == UNEXPLORED) {
-						_cells[row+i][col+j].explore();
-						openFreeSpace(row+i, col+j);
-					}
+//copies the current state of the board into the snapshot buffer read by the
+//render thread. Only called from the logic thread
+template <int H, int W>
+void Board<H, W>::publish() {
+	PROFILE_SCOPE("Board::publish");
+	Frame& frame = _frames.back();
+	frame.visibility.assign(_state._visibility.begin(), _state._visibility.end());
+	if(frame.layout.get() != _state._layout->data())
+		frame.layout = std::shared_ptr<const Cell>(_state._layout, _state._layout->data());
+	frame.height = height();
+	frame.width = width();
+	frame.seq = ++_seq;
+	_frames.publish();
+	_last_publish = Clock::now();
 }
 
-void Board::run() {
+//called by the render thread once a frame has been presented. Every applied
+//move whose update is included in that frame gets its latencies recorded
+template <int H, int W>
+void Board<H, W>::recordLatency(unsigned seq, Clock::time_point submitted, Clock::time_point presented) {
+	Move move;
+	while(_applied.tryPop(move))
+		_pending_latency.push_back(move);
+
+	while(!_pending_latency.empty() && _pending_latency.front().frame <= seq) {
+		_latency.record(_pending_latency.front(), submitted, presented);
+		_pending_latency.pop_front();
+	}
+}
+
+template <int H, int W>
+Visibility Board<H, W>::explore(int row, int col) {
+	return _state.explore(row, col);
+}
+
+template <int H, int W>
+bool Board<H, W>::chord(int row, int col) {
+	return _state.chord(row, col);
+}
+
+template <int H, int W>
+bool Board<H, W>::toggleFlag(int row, int col) {
+	return _state.toggleFlag(row, col);
+}
+
+//takes back the last explore, flag or chord, including its whole cascade
+template <int H, int W>
+bool Board<H, W>::undo() {
+	return _history.undo([&](const History::Change& change, Visibility visibility) {
+		_state.restore(change.idx, visibility);
+	});
+}
+
+template <int H, int W>
+bool Board<H, W>::redo() {
+	return _history.redo([&](const History::Change& change, Visibility visibility) {
+		_state.restore(change.idx, visibility);
+	});
+}
+
+//history is recorded by default. Simulations that never undo can turn it off
+//to save the memory and the time
+template <int H, int W>
+void Board<H, W>::recordHistory(bool on) {
+	_state.recordTo(on ? &_history : nullptr);
+}
+
+template <int H, int W>
+void Board<H, W>::applyMove(const Move& move) {
+	if(move.button == RIGHT)
+		toggleFlag(move.row, move.col);
+	if(move.button == LEFT)
+		explore(move.row, move.col);
+	if(move.button == MIDDLE)
+		chord(move.row, move.col);
+	if(move.button == UNDO)
+		undo();
+	if(move.button == REDO)
+		redo();
+}
+
+//game logic runs here, on its own thread. It owns _state: the render thread
+//only ever sees the copies handed over through _frames
+template <int H, int W>
+void Board<H, W>::logicLoop() {
+	Move move;
+	while(!_moves.closed()) {
+		if(_moves.pop(move, std::chrono::milliseconds(100)))
+			play(move);
+	}
+}
+
+//the logic thread without a player: EndgameSolver plays on every core, here
+//rather than on the render thread, which keeps presenting frames while it
+//thinks. It is asked for a move only once the frame on screen shows the
+//result of the previous one
+template <int H, int W>
+void Board<H, W>::autoPlayLoop() {
+	std::random_device seed;
+	EndgameSolver solver(seed(), std::max(1, (int)std::thread::hardware_concurrency()), std::chrono::milliseconds(SOLVER_THINK_MS));
+	solver.newGame(height(), width(), _state._bomb_cnt);
+	_state.trackFrontier(true);
+	const Frontier<H, W>& frontier = _state.frontier();
+	std::vector<int8_t> contents(height()*width());
+	Observation observation = {contents.data(), height(), width(), _state._bomb_cnt, &frontier.cells(), &frontier.constraints()};
+	Clock::time_point next_move = Clock::now();
+
+	while(!_moves.closed()) {
+		if(_game_over || _presented != _seq || Clock::now() < next_move) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(SOLVER_POLL_MS));
+			continue;
+		}
+
+		exportContents(_state.view(), contents.data(), width());
+		Action action;
+		{
+			PROFILE_SCOPE("Solver::nextMove");
+			action = solver.nextMove(observation);
+		}
+		play({action.row, action.col, action.button, Clock::now()});
+		next_move = Clock::now()+std::chrono::milliseconds(SOLVER_MOVE_MS);
+	}
+}
+
+//applies a move and publishes the result. Once the game is over the board
+//stays on screen and only undo and redo are accepted
+template <int H, int W>
+void Board<H, W>::play(Move move) {
+	if(_game_over && move.button != UNDO && move.button != REDO)
+		return;
+
+	if(move.row < 0 || move.row >= height() || move.col < 0 || move.col >= width())
+		return;
+
+	applyMove(move);
+	_game_over = endOfGame();
+
+	move.applied = Clock::now();
+	move.frame = _seq+1;
+	_applied.push(move);
+	publish();
+}
+
+template <int H, int W>
+void Board<H, W>::run() {
 	char ans;
 	std::cout << "Do you want to play the game yourself? (y/n)" << std::endl;
 	std::cin >> ans;
 
-	if(ans == 'y') {
-		int x, y;
-		MouseButton button;
-		_gui = Gui(10, 10, true);
-		glfwSetWindowUserPointer(_gui._window, &_gui);
-
-		while(!endOfGame() && !glfwWindowShouldClose(_gui._window)) {
-			_gui.drawBoard(_cells);
-			if(_gui.getLastMousePress(x, y, button)) {
-				if(button == RIGHT) {
-					if(_cells[y][x].getVisibility() == UNEXPLORED)
-						_cells[y][x].flag();
-					else if(_cells[y][x].getVisibility() == FLAGGED)
-						_cells[y][x].unflag();
-				}
-				if(button == LEFT) {
-					if(_cells[y][x].getVisibility() == UNEXPLORED) {
-						if(_cells[y][x].explore() == BOMB);
-							//return;
-						openFreeSpace(y, x);
-					}
-				}
-			}
+	bool human = ans == 'y';
+	Move move;
+	//on screen, the first click is never a bomb
+	_state.setSafeFirstClick(true);
+	//set MINESWEEPER_TRACE to a file name to record a Chrome trace
+	const char* trace = std::getenv("MINESWEEPER_TRACE");
+	Profiler::instance().enable(trace != nullptr);
 
-		}
+	_gui = Gui(height(), width(), human);
+	glfwSetWindowUserPointer(_gui._window, &_gui);
+
+	publish();
+	std::thread logic(human ? &Board<H, W>::logicLoop : &Board<H, W>::autoPlayLoop, this);
+
+	//the render thread keeps drawing the latest snapshot at the display
+	//rate, whatever the logic thread is busy with
+	while(!glfwWindowShouldClose(_gui._window)) {
+		const Frame& frame = _frames.acquire();
+		_gui.drawBoard(frame.view());
+		if(_gui.showLatency())
+			_gui.drawLatencyOverlay(_latency);
+		if(_gui.showProfiler())
+			_gui.drawProfilerOverlay(Profiler::instance());
+		Clock::time_point submitted = Clock::now();
+
+		_gui.swapBuffers();
+		recordLatency(frame.seq, submitted, Clock::now());
+		_presented = frame.seq;
+		Profiler::instance().frame();
+
+		_gui.pollEvents();
+		if(human && _gui.getLastMousePress(move))
+			_moves.push(move);
+	}
+
+	_moves.close();
+	logic.join();
+
+	//set MINESWEEPER_LATENCY_JSON to a file name to keep the histograms
+	if(const char* path = std::getenv("MINESWEEPER_LATENCY_JSON")) {
+		std::ofstream out(path);
+		_latency.writeJson(out);
 	}
-	else {
-		_gui = Gui(10, 10, false);
-		//play here
+	if(trace) {
+		std::ofstream out(trace);
+		Profiler::instance().writeChromeTrace(out);
 	}
 }
 
-bool Board::endOfGame() {
-	return false;
+template <int H, int W>
+bool Board<H, W>::won() const {
+	return _state.won();
 }
 
+template <int H, int W>
+bool Board<H, W>::lost() const {
+	return _state.lost();
+}
+
+template <int H, int W>
+bool Board<H, W>::endOfGame() const {
+	return _state.endOfGame();
+}
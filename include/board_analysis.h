@@ -0,0 +1,253 @@
+#pragma once
+
+#include <algorithm>
+#include <vector>
+#include "def.h"
+#include "cell.h"
+#include "grid.h"
+
+/*
+struct BoardMetrics and class BoardAnalyzer are defined in this file
+
+BoardAnalyzer grades a board from its layout alone, before anyone plays it:
+
+	openings --> the regions of connected zero cells (8 neighbours). One
+				click explores a whole opening and its border.
+
+	3BV --> Bechtel's Board Benchmark Value, the fewest left clicks that
+				clear the board: one per opening, plus one per safe cell that
+				no opening explores (a number with no zero around it).
+
+	islands --> the regions of connected numbers no opening explores, the
+				parts of the board that have to be cleared cell by cell.
+
+	guessing --> the share of the safe cells behind a guess. A player starts
+				from the largest opening and only makes the moves the
+				single-cell rules prove safe (a number whose missing bombs
+				fill its unexplored neighbours flags them, a number with all
+				its bombs flagged explores the others); the safe cells left
+				when no rule applies need at least one guess. A board with no
+				opening is all guessing.
+
+Openings and islands are labelled by union-find over the padded storage, in
+a single raster pass that joins every cell to the neighbours before it, then
+counted by their roots. The contents of the layout are copied once per board
+to a byte per cell, so the passes never go through the visibility of Cell.
+An analyzer reuses its buffers from one board to the next and only reads the
+layout, so every thread should have its own, and it can grade boards
+generated by Cell::initBoard without a BoardState around them (generate()).
+*/
+struct BoardMetrics {
+	int bbbv, openings, islands;
+	float guessing;
+};
+
+template <int H = 0, int W = 0>
+class BoardAnalyzer
+{
+public:
+	typedef typename Grid<H, W>::template Array<Cell> Layout;
+
+	BoardAnalyzer(int height, int width);
+
+	BoardMetrics analyze(const Layout& layout);
+	BoardMetrics generate(int bomb_cnt, unsigned seed);
+	const Layout& layout() const { return _layout; }
+
+private:
+	//what the player of the guessing pass knows of a cell
+	enum Known : int8_t {HIDDEN = 0, SHOWN = 1, MARKED = 2, OUTSIDE = 3};
+
+	int root(int idx);
+	template <typename P> void label(P belongs);
+	int guessFree(int start);
+	void show(int idx, int& shown);
+	void check(int idx);
+
+	Grid<H, W> _grid;
+	Layout _layout;
+	//the getContent() of every cell of the board being graded, SENTINEL on
+	//the border, and whether a zero is next to it
+	std::vector<int8_t> _content;
+	std::vector<int8_t> _near_zero;
+	std::vector<int> _parent;
+	std::vector<int> _size;
+	std::vector<int8_t> _known;
+	//the numbers of the guessing pass whose rules may apply, each once
+	std::vector<int8_t> _queued;
+	std::vector<int> _stack;
+	std::vector<int> _numbers;
+};
+
+
+template <int H, int W>
+BoardAnalyzer<H, W>::BoardAnalyzer(int height, int width) : _grid(height, width) {
+	_content.assign(_grid.storageSize(), SENTINEL);
+	_near_zero.assign(_grid.storageSize(), 0);
+	_parent.assign(_grid.storageSize(), -1);
+	_size.assign(_grid.storageSize(), 0);
+	_known.assign(_grid.storageSize(), OUTSIDE);
+	_queued.assign(_grid.storageSize(), 0);
+}
+
+//places bomb_cnt bombs with seed, as a game would, and grades the board
+template <int H, int W>
+BoardMetrics BoardAnalyzer<H, W>::generate(int bomb_cnt, unsigned seed) {
+	_grid.allocate(_layout, Cell(), Cell::sentinel());
+	Cell::initBoard(_layout, _grid, bomb_cnt, seed);
+	_grid.forEachCell([&](int idx) { _layout[idx].setVisibility(FREE); });
+	return analyze(_layout);
+}
+
+//layout is the padded storage of a board with every cell explored, like the
+//layout of a BoardState
+template <int H, int W>
+BoardMetrics BoardAnalyzer<H, W>::analyze(const Layout& layout) {
+	BoardMetrics metrics = {0, 0, 0, 0};
+	int safe = 0;
+	_grid.forEachCell([&](int idx) {
+		_content[idx] = layout[idx].getContent();
+		safe += _content[idx] != BOMB;
+		_near_zero[idx] = 0;
+	});
+	_grid.forEachCell([&](int idx) {
+		if(_content[idx] == 0)
+			_grid.forEachNeighbour(idx, [&](int n) { _near_zero[n] = 1; });
+	});
+
+	//the zeros and the numbers no opening explores are never next to each
+	//other, so one labelling finds both the openings and the islands. The
+	//guessing pass starts from the largest opening
+	label([&](int idx) { return _content[idx] == 0 || (_content[idx] > 0 && !_near_zero[idx]); });
+	int start = -1;
+	_grid.forEachCell([&](int idx) {
+		if(_parent[idx] < 0)
+			return;
+		bool opening = _content[idx] == 0;
+		metrics.bbbv += !opening;
+		if(_parent[idx] != idx)
+			return;
+		if(!opening) {
+			metrics.islands++;
+			return;
+		}
+		metrics.openings++;
+		if(start < 0 || _size[idx] > _size[start])
+			start = idx;
+	});
+	metrics.bbbv += metrics.openings;
+
+	int free = start < 0 ? 0 : guessFree(start);
+	metrics.guessing = safe ? float(safe-free)/safe : 0;
+	return metrics;
+}
+
+template <int H, int W>
+int BoardAnalyzer<H, W>::root(int idx) {
+	while(_parent[idx] != idx)
+		idx = _parent[idx] = _parent[_parent[idx]];
+	return idx;
+}
+
+//joins the cells for which belongs() is true into their 8-connected regions.
+//Afterwards _parent[idx] is -1 for the others and the root of the region
+//for the rest, and _size[root] the cells of the region
+template <int H, int W>
+template <typename P>
+void BoardAnalyzer<H, W>::label(P belongs) {
+	//the neighbours already visited by the raster scan. Sentinels never
+	//belong to a region and keep a parent of -1
+	int stride = _grid.stride();
+	const int before[4] = {-stride-1, -stride, -stride+1, -1};
+	_grid.forEachCell([&](int idx) {
+		if(!belongs(idx)) {
+			_parent[idx] = -1;
+			return;
+		}
+		_parent[idx] = idx;
+		_size[idx] = 0;
+		for (int offset : before) {
+			int n = idx+offset;
+			if(_parent[n] < 0)
+				continue;
+			int a = root(idx), b = root(n);
+			if(a != b)
+				_parent[std::max(a, b)] = std::min(a, b);
+		}
+	});
+	_grid.forEachCell([&](int idx) {
+		if(_parent[idx] >= 0)
+			_size[_parent[idx] = root(idx)]++;
+	});
+}
+
+//the safe cells explored from start without a guess
+template <int H, int W>
+int BoardAnalyzer<H, W>::guessFree(int start) {
+	_grid.forEachCell([&](int idx) { _known[idx] = HIDDEN; });
+	_numbers.clear();
+	int shown = 0;
+	show(start, shown);
+
+	while(!_numbers.empty()) {
+		int idx = _numbers.back();
+		_numbers.pop_back();
+		_queued[idx] = 0;
+		int hidden = 0, marked = 0, content = _content[idx];
+		_grid.forEachNeighbour(idx, [&](int n) {
+			hidden += _known[n] == HIDDEN;
+			marked += _known[n] == MARKED;
+		});
+		if(hidden == 0 || (marked != content && marked+hidden != content))
+			continue;
+
+		bool bombs = marked != content;
+		_grid.forEachNeighbour(idx, [&](int n) {
+			if(_known[n] != HIDDEN)
+				return;
+			if(bombs) {
+				_known[n] = MARKED;
+				check(n);
+			}
+			else
+				show(n, shown);
+		});
+	}
+	return shown;
+}
+
+//explores idx, and the opening it is in if it is a zero, counting the cells
+//in shown
+template <int H, int W>
+void BoardAnalyzer<H, W>::show(int idx, int& shown) {
+	_known[idx] = SHOWN;
+	_stack.assign(1, idx);
+	while(!_stack.empty()) {
+		int cell = _stack.back();
+		_stack.pop_back();
+		shown++;
+		check(cell);
+		if(_content[cell] != 0)
+			continue;
+		_grid.forEachNeighbour(cell, [&](int n) {
+			if(_known[n] == HIDDEN) {
+				_known[n] = SHOWN;
+				_stack.push_back(n);
+			}
+		});
+	}
+}
+
+//queues the numbers shown around idx, and idx itself, whose rules may apply
+//now that idx changed
+template <int H, int W>
+void BoardAnalyzer<H, W>::check(int idx) {
+	auto queue = [&](int n) {
+		if(_known[n] == SHOWN && _content[n] > 0 && !_queued[n]) {
+			_queued[n] = 1;
+			_numbers.push_back(n);
+		}
+	};
+	queue(idx);
+	_grid.forEachNeighbour(idx, queue);
+}
@@ -0,0 +1,251 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include <vector>
+#include "def.h"
+#include "cell.h"
+#include "grid.h"
+#include "channel.h"
+
+/*
+struct CorpusHeader and classes CorpusWriter and CorpusReader are defined in
+this file
+
+A corpus is a file of boards of the same size, written by minesweeper_gen
+for analyses that need many more boards than a process can afford to
+generate every time. It is a CorpusHeader followed by fixed-size records,
+one per board, in the byte order of the machine that wrote it:
+
+	seed --> 4 bytes, the seed the board was generated with: the same board
+				is BoardState(height, width, bomb_cnt, seed).
+
+	bombs --> one bit per cell, row by row (bit i%8 of byte i/8 for the cell
+				i = row*width+col), set for the bombs. An expert board fits in
+				60 bytes, so a record is 64.
+
+The number of boards follows from the size of the file. packBoard() and
+unpackBoard() turn the padded layout of a board into a record and back, and
+packBombs() and unpackBombs() do the same for the bits alone, which the
+indexed corpus (see corpus_index.h) stores apart from the seeds.
+
+CorpusWriter hands blocks of records to a writer thread through a bounded
+Channel (CORPUS_QUEUE_BLOCKS blocks), so the generating threads only wait
+when the disk falls behind, and every block goes to the file in one
+unbuffered write. CorpusReader streams the records back CORPUS_READ_BOARDS
+at a time.
+*/
+#define CORPUS_MAGIC "MSCORPUS"
+#define CORPUS_VERSION 1
+#define CORPUS_QUEUE_BLOCKS 4
+#define CORPUS_READ_BOARDS 4096
+//flags of CorpusHeader: every board was kept by the guess-free filter
+#define CORPUS_GUESS_FREE 1
+
+struct CorpusHeader {
+	char magic[8];
+	uint32_t version;
+	uint32_t height, width, bomb_cnt;
+	uint32_t record_bytes;
+	uint32_t flags;
+	//the seed the seeds of the boards were drawn from
+	uint64_t seed;
+};
+
+inline int corpusRecordBytes(int height, int width) {
+	return 4+(height*width+7)/8;
+}
+
+inline CorpusHeader corpusHeader(int height, int width, int bomb_cnt, uint64_t seed, uint32_t flags) {
+	CorpusHeader header;
+	std::memcpy(header.magic, CORPUS_MAGIC, sizeof(header.magic));
+	header.version = CORPUS_VERSION;
+	header.height = height;
+	header.width = width;
+	header.bomb_cnt = bomb_cnt;
+	header.record_bytes = corpusRecordBytes(height, width);
+	header.flags = flags;
+	header.seed = seed;
+	return header;
+}
+
+//writes the bombs of layout, the padded storage of a board shaped like grid,
+//to bits
+template <int H, int W>
+void packBombs(const Grid<H, W>& grid, const typename Grid<H, W>::template Array<Cell>& layout, uint8_t* bits) {
+	std::memset(bits, 0, (grid.height()*grid.width()+7)/8);
+	for (int row = 0, i = 0; row < grid.height(); row++)
+		for (int col = 0; col < grid.width(); col++, i++)
+			if(layout[grid.index(row, col)].getContent() == BOMB)
+				bits[i >> 3] |= 1 << (i & 7);
+}
+
+//rebuilds the board of bits in layout, every cell explored like the layout
+//of a BoardState
+template <int H, int W>
+void unpackBombs(const Grid<H, W>& grid, const uint8_t* bits, typename Grid<H, W>::template Array<Cell>& layout) {
+	grid.allocate(layout, Cell(), Cell::sentinel());
+	for (int row = 0, i = 0; row < grid.height(); row++)
+		for (int col = 0; col < grid.width(); col++, i++)
+			if(bits[i >> 3] >> (i & 7) & 1)
+				Cell::placeBomb(layout, grid, grid.index(row, col));
+	grid.forEachCell([&](int idx) { layout[idx].setVisibility(FREE); });
+}
+
+template <int H, int W>
+void packBoard(const Grid<H, W>& grid, const typename Grid<H, W>::template Array<Cell>& layout, unsigned seed, uint8_t* record) {
+	uint32_t stored = seed;
+	std::memcpy(record, &stored, 4);
+	packBombs(grid, layout, record+4);
+}
+
+//returns the seed of the board
+template <int H, int W>
+unsigned unpackBoard(const Grid<H, W>& grid, const uint8_t* record, typename Grid<H, W>::template Array<Cell>& layout) {
+	uint32_t seed;
+	std::memcpy(&seed, record, 4);
+	unpackBombs(grid, record+4, layout);
+	return seed;
+}
+
+class CorpusWriter
+{
+public:
+	CorpusWriter() : _file(nullptr), _blocks(CORPUS_QUEUE_BLOCKS), _failed(false) {}
+	~CorpusWriter() { close(); }
+
+	bool open(const char* path, const CorpusHeader& header);
+	void write(std::vector<uint8_t>&& block);
+	bool close();
+
+private:
+	void drain();
+
+	std::FILE* _file;
+	Channel<std::vector<uint8_t>> _blocks;
+	std::thread _writer;
+	std::atomic<bool> _failed;
+};
+
+class CorpusReader
+{
+public:
+	CorpusReader() : _file(nullptr), _next(0), _end(0) {}
+	~CorpusReader() { close(); }
+
+	bool open(const char* path);
+	const CorpusHeader& header() const { return _header; }
+	const uint8_t* next();
+	void close();
+
+private:
+	std::FILE* _file;
+	CorpusHeader _header;
+	std::vector<uint8_t> _buffer;
+	size_t _next, _end;
+};
+
+
+/*************************************************************************
+CorpusWriter
+*************************************************************************/
+
+//creates the file, writes the header and starts the writer thread
+inline bool CorpusWriter::open(const char* path, const CorpusHeader& header) {
+	_file = std::fopen(path, "wb");
+	if(!_file)
+		return false;
+	std::setvbuf(_file, nullptr, _IONBF, 0);
+	if(std::fwrite(&header, sizeof(header), 1, _file) != 1) {
+		std::fclose(_file);
+		_file = nullptr;
+		return false;
+	}
+	_writer = std::thread(&CorpusWriter::drain, this);
+	return true;
+}
+
+//queues a block of whole records, waiting if CORPUS_QUEUE_BLOCKS are already
+//queued
+inline void CorpusWriter::write(std::vector<uint8_t>&& block) {
+	_blocks.push(std::move(block));
+}
+
+//the writer thread. Once the channel is closed, nothing else can be pushed,
+//so what is left is written and the thread ends
+inline void CorpusWriter::drain() {
+	std::vector<uint8_t> block;
+	auto store = [&] {
+		if(!_failed && std::fwrite(block.data(), 1, block.size(), _file) != block.size())
+			_failed = true;
+	};
+	while(true) {
+		if(_blocks.pop(block, std::chrono::milliseconds(100))) {
+			store();
+			continue;
+		}
+		if(!_blocks.closed())
+			continue;
+		while(_blocks.tryPop(block))
+			store();
+		return;
+	}
+}
+
+//writes the blocks still queued and closes the file. Returns false if any
+//write failed
+inline bool CorpusWriter::close() {
+	if(!_file)
+		return !_failed;
+	_blocks.close();
+	_writer.join();
+	if(std::fclose(_file))
+		_failed = true;
+	_file = nullptr;
+	return !_failed;
+}
+
+
+/*************************************************************************
+CorpusReader
+*************************************************************************/
+
+//opens a corpus and checks its header
+inline bool CorpusReader::open(const char* path) {
+	_file = std::fopen(path, "rb");
+	if(!_file)
+		return false;
+	if(std::fread(&_header, sizeof(_header), 1, _file) != 1 || std::memcmp(_header.magic, CORPUS_MAGIC, sizeof(_header.magic)) ||
+	   _header.version != CORPUS_VERSION || (int)_header.record_bytes != corpusRecordBytes(_header.height, _header.width)) {
+		close();
+		return false;
+	}
+	_buffer.resize((size_t)CORPUS_READ_BOARDS*_header.record_bytes);
+	_next = _end = 0;
+	return true;
+}
+
+//the next record, nullptr at the end of the file. It stays valid until the
+//next call
+inline const uint8_t* CorpusReader::next() {
+	if(_next == _end) {
+		if(!_file)
+			return nullptr;
+		_end = std::fread(_buffer.data(), _header.record_bytes, CORPUS_READ_BOARDS, _file)*_header.record_bytes;
+		_next = 0;
+		if(_end == 0)
+			return nullptr;
+	}
+	const uint8_t* record = _buffer.data()+_next;
+	_next += _header.record_bytes;
+	return record;
+}
+
+inline void CorpusReader::close() {
+	if(_file)
+		std::fclose(_file);
+	_file = nullptr;
+}
@@ -0,0 +1,373 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "def.h"
+#include "board_state.h"
+
+/*
+the board and replay formats of other minesweeper programs are read and
+written in this file
+
+A board read from a file is a BoardFile: its size and the cells of its bombs,
+numbered row*width+col, ready for BoardState::load(). A replay is a
+BoardFile and the moves played on it, each an Action at a time in seconds.
+
+	MBF --> the binary board format: the width and the height in a byte
+				each, the bomb count in two bytes (big-endian), then the
+				column and the row of every bomb in a byte each. Boards are
+				at most 255x255.
+
+	text --> a row of characters per line, '*' (or 'x', 'X', 'M') for a
+				bomb and anything else of '.', '_', '0'-'8' for a safe cell,
+				blanks between them ignored. A board ends at an empty line or
+				at the end of the data. It is written with '*' for the bombs,
+				'.' for the zeros and the digit of the others.
+
+	RAWVF --> the text replay format of the Arbiter video tools: "Key:
+				value" header lines (Width, Height and Mines are required),
+				then "Board:" and a row per line of '*' for the bombs and '0'
+				for the rest, then "Events:" and a line per mouse event, "time
+				type column row (x y)" with 1-based cells. A left release
+				explores, a right press flags, a middle release chords, and
+				so does releasing either button while both are down. Other
+				events (moves, "start", "won"...) are skipped.
+
+The parsers take the bytes of a whole file (readFile() reuses its buffer
+from one file to the next), go through them once, and write to a BoardFile
+or a Replay whose vectors keep their capacity between calls, so a stream of
+files of similar boards allocates nothing after the first. They return the
+bytes used, so several text boards can be parsed from one buffer, and 0 if
+the data is not a valid board. The writers append to a string; writeMbf()
+refuses the boards too large for the format.
+*/
+struct BoardFile {
+	int height, width;
+	std::vector<int> bombs;
+};
+
+struct ReplayEvent {
+	float time;
+	Action action;
+};
+
+struct Replay {
+	BoardFile board;
+	std::vector<ReplayEvent> events;
+};
+
+//the pixel size of a cell in the mouse positions of RAWVF events
+#define RAWVF_SQUARE 16
+
+//a cursor over the bytes of a text format, never reading past end
+class TextCursor
+{
+public:
+	TextCursor(const char* data, size_t size) : _at(data), _end(data+size) {}
+
+	bool done() const { return _at == _end; }
+	const char* at() const { return _at; }
+
+	//the next line without its end of line, advancing past it
+	bool line(const char*& begin, const char*& end) {
+		if(_at == _end)
+			return false;
+		begin = _at;
+		while(_at != _end && *_at != '\n')
+			_at++;
+		end = _at;
+		if(_at != _end)
+			_at++;
+		if(end != begin && end[-1] == '\r')
+			end--;
+		return true;
+	}
+
+	static void skipBlanks(const char*& at, const char* end) {
+		while(at != end && (*at == ' ' || *at == '\t'))
+			at++;
+	}
+
+	//reads an unsigned integer at at, false if there is none
+	static bool number(const char*& at, const char* end, int& value) {
+		skipBlanks(at, end);
+		if(at == end || *at < '0' || *at > '9')
+			return false;
+		value = 0;
+		while(at != end && *at >= '0' && *at <= '9' && value < (1 << 27))
+			value = value*10+(*at++ - '0');
+		return true;
+	}
+
+	//reads a decimal number like -12.345 at at, false if there is none
+	static bool decimal(const char*& at, const char* end, float& value) {
+		skipBlanks(at, end);
+		bool negative = at != end && *at == '-';
+		at += negative;
+		int whole;
+		if(!number(at, end, whole))
+			return false;
+		value = whole;
+		if(at != end && *at == '.')
+			for (float unit = 0.1f; ++at != end && *at >= '0' && *at <= '9'; unit /= 10)
+				value += (*at-'0')*unit;
+		value = negative ? -value : value;
+		return true;
+	}
+
+	//true if [begin, end) starts with word, leaving begin after it
+	static bool startsWith(const char*& begin, const char* end, const char* word) {
+		size_t length = std::strlen(word);
+		if((size_t)(end-begin) < length || std::memcmp(begin, word, length))
+			return false;
+		begin += length;
+		return true;
+	}
+
+private:
+	const char* _at;
+	const char* _end;
+};
+
+//reads a whole file into buffer, reusing its storage
+inline bool readFile(const char* path, std::string& buffer) {
+	std::FILE* file = std::fopen(path, "rb");
+	if(!file)
+		return false;
+	buffer.clear();
+	char chunk[1 << 16];
+	size_t read;
+	while((read = std::fread(chunk, 1, sizeof(chunk), file)) > 0)
+		buffer.append(chunk, read);
+	bool failed = std::ferror(file);
+	std::fclose(file);
+	return !failed;
+}
+
+//an MBF board may list a cell twice. The bits of a bitset big enough for any
+//MBF board are cleared before they are used, so it is never cleared whole
+inline size_t parseMbf(const char* data, size_t size, BoardFile& board) {
+	uint64_t seen[(255*255+63)/64];
+	const uint8_t* bytes = reinterpret_cast<const uint8_t*>(data);
+	if(size < 4)
+		return 0;
+	board.width = bytes[0];
+	board.height = bytes[1];
+	size_t count = bytes[2] << 8 | bytes[3];
+	if(!board.width || !board.height || size < 4+2*count)
+		return 0;
+	board.bombs.clear();
+	for (size_t b = 0; b < count; b++) {
+		int col = bytes[4+2*b], row = bytes[5+2*b];
+		if(col >= board.width || row >= board.height)
+			return 0;
+		board.bombs.push_back(row*board.width+col);
+		seen[board.bombs.back() >> 6] = 0;
+	}
+	for (int bomb : board.bombs) {
+		if(seen[bomb >> 6] >> (bomb & 63) & 1)
+			return 0;
+		seen[bomb >> 6] |= (uint64_t)1 << (bomb & 63);
+	}
+	return 4+2*count;
+}
+
+inline size_t parseText(const char* data, size_t size, BoardFile& board) {
+	TextCursor cursor(data, size);
+	const char *begin, *end;
+	board.height = board.width = 0;
+	board.bombs.clear();
+	while(cursor.line(begin, end)) {
+		TextCursor::skipBlanks(begin, end);
+		if(begin == end) {
+			if(board.height)
+				break;
+			continue;
+		}
+		int col = 0;
+		for (; begin != end; begin++) {
+			char c = *begin;
+			if(c == ' ' || c == '\t')
+				continue;
+			if(c == '*' || c == 'x' || c == 'X' || c == 'M')
+				board.bombs.push_back(board.height*board.width+col);
+			else if(c != '.' && c != '_' && (c < '0' || c > '8'))
+				return 0;
+			col++;
+		}
+		if(board.height == 0)
+			board.width = col;
+		else if(col != board.width)
+			return 0;
+		board.height++;
+	}
+	return board.height ? cursor.at()-data : 0;
+}
+
+inline size_t parseRawvf(const char* data, size_t size, Replay& replay) {
+	TextCursor cursor(data, size);
+	const char *begin, *end;
+	BoardFile& board = replay.board;
+	board.height = board.width = 0;
+	board.bombs.clear();
+	replay.events.clear();
+	int mines = -1;
+
+	//the header, up to the board
+	bool found = false;
+	while(!found && cursor.line(begin, end)) {
+		if(TextCursor::startsWith(begin, end, "Width:"))
+			TextCursor::number(begin, end, board.width);
+		else if(TextCursor::startsWith(begin, end, "Height:"))
+			TextCursor::number(begin, end, board.height);
+		else if(TextCursor::startsWith(begin, end, "Mines:"))
+			TextCursor::number(begin, end, mines);
+		else if(TextCursor::startsWith(begin, end, "Board:"))
+			found = true;
+	}
+	if(!found || board.width <= 0 || board.height <= 0)
+		return 0;
+	for (int row = 0; row < board.height; row++) {
+		if(!cursor.line(begin, end) || end-begin != board.width)
+			return 0;
+		for (int col = 0; col < board.width; col++)
+			if(begin[col] == '*')
+				board.bombs.push_back(row*board.width+col);
+			else if(begin[col] != '0')
+				return 0;
+	}
+	if((int)board.bombs.size() != mines)
+		return 0;
+
+	//the events, after "Events:". The buttons held decide what a release does
+	while(cursor.line(begin, end) && !TextCursor::startsWith(begin, end, "Events:"))
+		;
+	bool left = false, right = false, both = false, chorded = false;
+	while(cursor.line(begin, end)) {
+		float time;
+		if(!TextCursor::decimal(begin, end, time))
+			continue;
+		TextCursor::skipBlanks(begin, end);
+		const char* type = begin;
+		while(begin != end && *begin != ' ' && *begin != '\t')
+			begin++;
+		if(begin-type != 2)
+			continue;
+		int col, row;
+		if(!TextCursor::number(begin, end, col) || !TextCursor::number(begin, end, row))
+			continue;
+		auto play = [&](MouseButton button) {
+			if(col >= 1 && col <= board.width && row >= 1 && row <= board.height)
+				replay.events.push_back({time, {row-1, col-1, button}});
+		};
+		//a release while both buttons are down chords once, and the other
+		//release does nothing
+		auto release = [&](bool& button, bool other, bool explores) {
+			button = false;
+			if(!both) {
+				if(explores)
+					play(LEFT);
+			}
+			else if(!chorded) {
+				play(MIDDLE);
+				chorded = true;
+			}
+			if(!other)
+				both = chorded = false;
+		};
+		if(!std::memcmp(type, "lc", 2)) {
+			left = true;
+			both = both || right;
+		}
+		else if(!std::memcmp(type, "rc", 2)) {
+			right = true;
+			both = both || left;
+			if(!both)
+				play(RIGHT);
+		}
+		else if(!std::memcmp(type, "lr", 2))
+			release(left, right, true);
+		else if(!std::memcmp(type, "rr", 2))
+			release(right, left, false);
+		else if(!std::memcmp(type, "mr", 2))
+			play(MIDDLE);
+	}
+	return cursor.at()-data;
+}
+
+//returns false, writing nothing, for a board MBF can't hold: over 255 cells
+//wide or high, or with over 65535 bombs
+template <int H, int W>
+bool writeMbf(const BoardState<H, W>& state, std::string& out) {
+	int count = 0;
+	state._grid.forEachCell([&](int idx) { count += (*state._layout)[idx].getContent() == BOMB; });
+	if(state.width() > 255 || state.height() > 255 || count > 65535)
+		return false;
+
+	out.push_back((char)state.width());
+	out.push_back((char)state.height());
+	out.push_back((char)(count >> 8));
+	out.push_back((char)(count & 0xff));
+	for (int row = 0; row < state.height(); row++)
+		for (int col = 0; col < state.width(); col++)
+			if((*state._layout)[state._grid.index(row, col)].getContent() == BOMB) {
+				out.push_back((char)col);
+				out.push_back((char)row);
+			}
+	return true;
+}
+
+//followed by an empty line, so that boards can be written one after the other
+template <int H, int W>
+void writeText(const BoardState<H, W>& state, std::string& out) {
+	for (int row = 0; row < state.height(); row++) {
+		for (int col = 0; col < state.width(); col++) {
+			int content = (*state._layout)[state._grid.index(row, col)].getContent();
+			out.push_back(content == BOMB ? '*' : content == 0 ? '.' : char('0'+content));
+		}
+		out.push_back('\n');
+	}
+	out.push_back('\n');
+}
+
+//events are written as the presses and releases that parseRawvf reads back
+//as the same actions
+template <int H, int W>
+void writeRawvf(const BoardState<H, W>& state, const std::vector<ReplayEvent>& events, std::string& out) {
+	char line[96];
+	int bombs = 0;
+	state._grid.forEachCell([&](int idx) { bombs += (*state._layout)[idx].getContent() == BOMB; });
+	std::snprintf(line, sizeof(line), "RawVF_Version: Rev4\nWidth: %d\nHeight: %d\nMines: %d\nBoard:\n", state.width(), state.height(), bombs);
+	out += line;
+	for (int row = 0; row < state.height(); row++) {
+		for (int col = 0; col < state.width(); col++)
+			out.push_back((*state._layout)[state._grid.index(row, col)].getContent() == BOMB ? '*' : '0');
+		out.push_back('\n');
+	}
+	out += "Events:\n";
+	for (const ReplayEvent& event : events) {
+		const char* types = event.action.button == LEFT ? "lclr" : event.action.button == RIGHT ? "rcrr" : event.action.button == MIDDLE ? "mcmr" : nullptr;
+		if(!types)
+			continue;
+		int col = event.action.col, row = event.action.row;
+		for (int half = 0; half < 2; half++) {
+			std::snprintf(line, sizeof(line), "%.3f %.2s %d %d (%d %d)\n", event.time, types+2*half, col+1, row+1, col*RAWVF_SQUARE+RAWVF_SQUARE/2,
+						  row*RAWVF_SQUARE+RAWVF_SQUARE/2);
+			out += line;
+		}
+	}
+}
+
+//loads the board of replay on state and plays its events. Returns false,
+//leaving state alone, if the board is not the size of state
+template <int H, int W>
+bool play(const Replay& replay, BoardState<H, W>& state) {
+	if(replay.board.height != state.height() || replay.board.width != state.width() || !state.load(replay.board.bombs))
+		return false;
+	for (const ReplayEvent& event : replay.events)
+		state.apply(event.action);
+	return true;
+}
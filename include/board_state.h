@@ -0,0 +1,506 @@
+#pragma once
+
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <vector>
+#include "def.h"
+#include "cell.h"
+#include "grid.h"
+#include "history.h"
+#include "frontier.h"
+#include "opening_index.h"
+#include "profiler.h"
+
+/*
+class BoardState is defined in this file
+
+BoardState is the rules engine of one game, without any window, thread or
+input around it. Board owns one; solvers and searches take cheap copies of
+it with fork(). It is made of two parts:
+
+	layout --> the board as it would look with every cell explored: where
+				the bombs are and how many bombs surround every other cell.
+				It never changes once generated, so it is shared (through a
+				shared_ptr to const) by a state and all of its forks, and can
+				be read from any number of threads. Its openings are indexed
+				along with it (see opening_index.h), so exploring a zero
+				reveals a precomputed list of cells instead of searching
+				for them.
+
+	visibility --> what the player has done so far: one byte per cell of the
+				padded storage saying whether it is UNEXPLORED, FREE, FLAGGED
+				or an exploded BOMB. This is the only part a fork copies, 576
+				bytes for an expert board.
+
+The explored-cell count and the lost flag are kept up to date with every
+change, so win and loss detection are O(1). On request (trackFrontier) the
+frontier and constraint cells are kept up to date too (see frontier.h).
+
+On request too (setSafeFirstClick), the first explore of a game never hits a
+bomb: the bomb moves to the first free cell in row-major order, as in the
+classic game, and the layout and its openings are updated in place (or
+copied, if a fork or a snapshot still shares them). Undo does not move it
+back. It is off by default, so a seed always gives the same game.
+*/
+//bomb counts of the standard difficulties: 9x9, 16x16 and 16x30 (see board.h)
+#define BEGINNER_BOMBS 10
+#define INTERMEDIATE_BOMBS 40
+#define EXPERT_BOMBS 99
+
+template <int H = 0, int W = 0>
+class BoardState
+{
+public:
+	typedef typename Grid<H, W>::template Array<Cell> Layout;
+	typedef void (*ProgressCallback)(void*);
+
+	BoardState(int height, int width, int bomb_cnt, unsigned seed = std::random_device()());
+	explicit BoardState(int bomb_cnt, unsigned seed = std::random_device()());
+	BoardState fork() const;
+	void reset(unsigned seed);
+	bool load(const std::vector<int>& bombs);
+
+	int height() const { return _grid.height(); }
+	int width() const { return _grid.width(); }
+	Cell cell(int row, int col) const { return at(_grid.index(row, col)); }
+	Cell at(int idx) const;
+	int content(int idx) const;
+	BoardView view() const { return {_layout->data(), _visibility.data(), height(), width(), _grid.stride()}; }
+
+	Visibility explore(int row, int col);
+	bool toggleFlag(int row, int col);
+	bool chord(int row, int col);
+	void apply(const Action& action);
+	void restore(int idx, Visibility visibility);
+
+	bool endOfGame() const;
+	bool won() const;
+	bool lost() const;
+	int revealed() const;
+
+	void recordTo(History* history);
+	void onProgress(ProgressCallback callback, void* context);
+	void trackFrontier(bool on);
+	void setSafeFirstClick(bool on) { _safe_first = on; }
+	const Frontier<H, W>& frontier() const { return _frontier; }
+
+	Grid<H, W> _grid;
+	int _bomb_cnt;
+	std::shared_ptr<const Layout> _layout;
+	std::shared_ptr<const OpeningIndex<H, W>> _openings;
+	typename Grid<H, W>::template Array<Visibility> _visibility;
+
+private:
+	template <typename P> void generate(P place);
+	void relocateBomb(int idx);
+	bool revealOpening(int idx);
+	void openFreeSpace();
+	void changed(int idx, Visibility before);
+
+	std::vector<int> _stack;
+	//the openings the current cascade floods instead of revealing them
+	std::vector<int> _flooded;
+	int _revealed_cnt;
+	bool _lost;
+	bool _safe_first;
+
+	Frontier<H, W> _frontier;
+	History* _history;
+	ProgressCallback _progress;
+	void* _progress_context;
+};
+
+
+template <int H, int W>
+BoardState<H, W>::BoardState(int height, int width, int bomb_cnt, unsigned seed) : _grid(height, width),
+																	_bomb_cnt(bomb_cnt),
+																	_revealed_cnt(0),
+																	_lost(false),
+																	_safe_first(false),
+																	_history(nullptr),
+																	_progress(nullptr),
+																	_progress_context(nullptr) {
+	generate([&](Layout& layout) { Cell::initBoard(layout, _grid, _bomb_cnt, seed); });
+}
+
+//fixed size boards only
+template <int H, int W>
+BoardState<H, W>::BoardState(int bomb_cnt, unsigned seed) : BoardState(H, W, bomb_cnt, seed) {
+	static_assert(H > 0 && W > 0, "BoardState<>(bomb_cnt) needs the dimensions, use BoardState<>(height, width, bomb_cnt)");
+}
+
+//places the bombs of a new game with place(layout) and covers every cell.
+//The storage of the layout and of its openings is reused when no fork still
+//shares it, so a simulation resetting the same state over and over does not
+//allocate
+template <int H, int W>
+template <typename P>
+void BoardState<H, W>::generate(P place) {
+	std::shared_ptr<Layout> layout;
+	if(_layout.use_count() == 1)
+		layout = std::const_pointer_cast<Layout>(_layout);
+	else
+		layout = std::make_shared<Layout>();
+	_layout.reset();
+	std::shared_ptr<OpeningIndex<H, W>> openings;
+	if(_openings.use_count() == 1)
+		openings = std::const_pointer_cast<OpeningIndex<H, W>>(_openings);
+	else
+		openings = std::make_shared<OpeningIndex<H, W>>();
+	_openings.reset();
+
+	_grid.allocate(*layout, Cell(), Cell::sentinel());
+	place(*layout);
+	_grid.forEachCell([&](int idx) { (*layout)[idx].setVisibility(FREE); });
+	openings->build(_grid, *layout);
+	_layout = layout;
+	_openings = openings;
+
+	_grid.allocate(_visibility, UNEXPLORED, SENTINEL);
+	if(_frontier.active())
+		_frontier.build(_grid, _visibility.data());
+}
+
+//starts a new game of the same size and bomb count on this state. Forks made
+//before keep playing the old game. The history, if any, is left alone and
+//should be cleared by its owner
+template <int H, int W>
+void BoardState<H, W>::reset(unsigned seed) {
+	generate([&](Layout& layout) { Cell::initBoard(layout, _grid, _bomb_cnt, seed); });
+	_stack.clear();
+	_revealed_cnt = 0;
+	_lost = false;
+}
+
+//same as reset, but the new game has its bombs on the given cells (numbered
+//row*width+col) instead of random ones, for boards read from a file (see
+//board_formats.h). A cell listed twice holds one bomb. Returns false, leaving
+//the game as it was, if a cell is off the board
+template <int H, int W>
+bool BoardState<H, W>::load(const std::vector<int>& bombs) {
+	for (int bomb : bombs)
+		if(bomb < 0 || bomb >= height()*width())
+			return false;
+
+	_bomb_cnt = 0;
+	generate([&](Layout& layout) {
+		//a bomb is uncovered as soon as it is placed, so that getContent()
+		//finds it if the cell comes again. Every cell is uncovered next anyway
+		for (int bomb : bombs) {
+			int idx = _grid.index(bomb/width(), bomb%width());
+			layout[idx].setVisibility(FREE);
+			if(layout[idx].getContent() == BOMB)
+				continue;
+			Cell::placeBomb(layout, _grid, idx);
+			_bomb_cnt++;
+		}
+	});
+	_stack.clear();
+	_revealed_cnt = 0;
+	_lost = false;
+	return true;
+}
+
+//a copy of the game that can be played on independently, for instance by a
+//solver trying a move. Only the visibility (and the frontier, if tracked) is
+//copied; the layout is shared. The copy records no history and reports no
+//progress
+template <int H, int W>
+BoardState<H, W> BoardState<H, W>::fork() const {
+	BoardState<H, W> copy(*this);
+	copy._history = nullptr;
+	copy._progress = nullptr;
+	return copy;
+}
+
+//the cell as the player sees it
+template <int H, int W>
+Cell BoardState<H, W>::at(int idx) const {
+	Cell cell = (*_layout)[idx];
+	cell.setVisibility(_visibility[idx]);
+	return cell;
+}
+
+//same as at(idx).getContent(): the number of bombs around an explored cell,
+//or the visibility of any other cell
+template <int H, int W>
+int BoardState<H, W>::content(int idx) const {
+	return _visibility[idx] == FREE ? (*_layout)[idx].getContent() : (int)_visibility[idx];
+}
+
+//moves the bomb under idx, the first cell explored, to the first free cell.
+//Nothing has been explored yet, so only the layout and its openings change
+template <int H, int W>
+void BoardState<H, W>::relocateBomb(int idx) {
+	int to = -1;
+	_grid.forEachCell([&](int n) {
+		if(to < 0 && (*_layout)[n].getContent() != BOMB)
+			to = n;
+	});
+	if(to < 0)
+		return;
+
+	std::shared_ptr<Layout> layout;
+	if(_layout.use_count() == 1)
+		layout = std::const_pointer_cast<Layout>(_layout);
+	else
+		layout = std::make_shared<Layout>(*_layout);
+	std::shared_ptr<OpeningIndex<H, W>> openings;
+	if(_openings.use_count() == 1)
+		openings = std::const_pointer_cast<OpeningIndex<H, W>>(_openings);
+	else
+		openings = std::make_shared<OpeningIndex<H, W>>(*_openings);
+
+	Cell::moveBomb(*layout, _grid, idx, to);
+	std::vector<int> changed = {idx, to};
+	for (int cell : {idx, to})
+		_grid.forEachNeighbour(cell, [&](int n) {
+			if((*layout)[n].getContent() != SENTINEL)
+				changed.push_back(n);
+		});
+	openings->update(_grid, *layout, changed);
+	_layout = layout;
+	_openings = openings;
+}
+
+//reveals the opening of the explored zero idx and its border in one pass over
+//its span. Only when its other zeros are all unexplored: a flagged or an
+//explored zero stops a flood fill, and the fill is left to handle it (once
+//per cascade, not for every zero it reaches). Returns false if it is
+template <int H, int W>
+bool BoardState<H, W>::revealOpening(int idx) {
+	const OpeningIndex<H, W>& openings = *_openings;
+	int id = openings.opening(idx);
+	if(std::find(_flooded.begin(), _flooded.end(), id) != _flooded.end())
+		return false;
+	for (const int* cell = openings.begin(id); cell != openings.end(id); cell++)
+		if(*cell != idx && openings.opening(*cell) == id && _visibility[*cell] != UNEXPLORED) {
+			_flooded.push_back(id);
+			return false;
+		}
+
+	int steps = 0;
+	for (const int* cell = openings.begin(id); cell != openings.end(id); cell++) {
+		if(_visibility[*cell] != UNEXPLORED)
+			continue;
+		_visibility[*cell] = FREE;
+		changed(*cell, UNEXPLORED);
+		_revealed_cnt++;
+		if(++steps % 4096 == 0 && _progress)
+			_progress(_progress_context);
+	}
+	return true;
+}
+
+//reveals the whole regions connected through empty cells to the cells on
+//_stack, which must already be explored. A zero whose opening is untouched
+//reveals it straight from the index; otherwise the cascade floods it. A
+//single work queue serves every seed, so a chord opening several regions at
+//once runs one cascade. The cascade uses an explicit stack instead of
+//recursion, so a reveal of millions of cells cannot overflow the call stack,
+//and it periodically reports progress so Board can show the reveal while it
+//is going on
+template <int H, int W>
+void BoardState<H, W>::openFreeSpace() {
+	PROFILE_SCOPE("Board::openFreeSpace");
+	const Layout& layout = *_layout;
+	int steps = 0;
+	_flooded.clear();
+
+	while(!_stack.empty()) {
+		int idx = _stack.back();
+		_stack.pop_back();
+
+		if(layout[idx].getContent() == 0 && !revealOpening(idx))
+			_grid.forEachNeighbour(idx, [&](int n) {
+				if(_visibility[n] == UNEXPLORED) {
+					_visibility[n] = FREE;
+					changed(n, UNEXPLORED);
+					_revealed_cnt++;
+					_stack.push_back(n);
+				}
+			});
+
+		if(++steps % 4096 == 0 && _progress)
+			_progress(_progress_context);
+	}
+}
+
+//explores a cell and, if it has no bombs around it, the whole empty region
+//it belongs to. Exploring a bomb loses the game. Returns the new visibility of
+//the cell, or its current one if it was not UNEXPLORED
+template <int H, int W>
+Visibility BoardState<H, W>::explore(int row, int col) {
+	int idx = _grid.index(row, col);
+	if(_visibility[idx] != UNEXPLORED)
+		return _visibility[idx];
+
+	if(_safe_first && _revealed_cnt == 0 && !_lost && (*_layout)[idx].getContent() == BOMB)
+		relocateBomb(idx);
+
+	if(_history)
+		_history->begin();
+	Visibility result = (*_layout)[idx].getContent() == BOMB ? BOMB : FREE;
+	_visibility[idx] = result;
+	changed(idx, UNEXPLORED);
+
+	if(result == BOMB)
+		_lost = true;
+	else {
+		_revealed_cnt++;
+		_stack.push_back(idx);
+		openFreeSpace();
+	}
+
+	if(_history)
+		_history->commit();
+	return result;
+}
+
+//chords a revealed number: if as many of its neighbours are flagged as it has
+//bombs around it, every other unexplored neighbour is explored in one batch,
+//cascading through a single shared work queue. A wrong flag means one of
+//them is a bomb and the game is lost. Returns false if the cell could not be
+//chorded
+template <int H, int W>
+bool BoardState<H, W>::chord(int row, int col) {
+	int idx = _grid.index(row, col);
+	int number = content(idx);
+	if(number <= 0)
+		return false;
+
+	int flags = 0;
+	_grid.forEachNeighbour(idx, [&](int n) {
+		flags += _visibility[n] == FLAGGED;
+	});
+	if(flags != number)
+		return false;
+
+	if(_history)
+		_history->begin();
+	_grid.forEachNeighbour(idx, [&](int n) {
+		if(_visibility[n] != UNEXPLORED)
+			return;
+		Visibility result = (*_layout)[n].getContent() == BOMB ? BOMB : FREE;
+		_visibility[n] = result;
+		changed(n, UNEXPLORED);
+		if(result == BOMB) {
+			_lost = true;
+			return;
+		}
+		_revealed_cnt++;
+		_stack.push_back(n);
+	});
+
+	openFreeSpace();
+	if(_history)
+		_history->commit();
+	return true;
+}
+
+//flags an unexplored cell or removes the flag of a flagged one. Returns false
+//if the cell is neither
+template <int H, int W>
+bool BoardState<H, W>::toggleFlag(int row, int col) {
+	int idx = _grid.index(row, col);
+	Visibility before = _visibility[idx];
+	if(before != UNEXPLORED && before != FLAGGED)
+		return false;
+
+	_visibility[idx] = before == UNEXPLORED ? FLAGGED : UNEXPLORED;
+	if(_history)
+		_history->begin();
+	changed(idx, before);
+	if(_history)
+		_history->commit();
+	return true;
+}
+
+//plays an explore, flag or chord. Actions outside the board or with any other
+//button change nothing
+template <int H, int W>
+void BoardState<H, W>::apply(const Action& action) {
+	if(action.row < 0 || action.row >= height() || action.col < 0 || action.col >= width())
+		return;
+
+	if(action.button == LEFT)
+		explore(action.row, action.col);
+	else if(action.button == RIGHT)
+		toggleFlag(action.row, action.col);
+	else if(action.button == MIDDLE)
+		chord(action.row, action.col);
+}
+
+//keeps track of a change of visibility of the cell idx, for undo and redo
+//and for the frontier. Must be called right after the change, inside a
+//History step
+template <int H, int W>
+void BoardState<H, W>::changed(int idx, Visibility before) {
+	if(_history)
+		_history->record(idx, before, _visibility[idx]);
+	if(_frontier.active())
+		_frontier.changed(_grid, _visibility.data(), idx, before);
+}
+
+//sets the visibility of a cell back or forward to a recorded state, keeping
+//the explored count and the lost state in step with it
+template <int H, int W>
+void BoardState<H, W>::restore(int idx, Visibility visibility) {
+	Visibility current = _visibility[idx];
+	_visibility[idx] = visibility;
+	if(_frontier.active())
+		_frontier.changed(_grid, _visibility.data(), idx, current);
+
+	_revealed_cnt += (visibility == FREE) - (current == FREE);
+	if(visibility == BOMB)
+		_lost = true;
+	else if(current == BOMB)
+		_lost = false;
+}
+
+//changes are recorded into history from now on, nullptr stops recording
+template <int H, int W>
+void BoardState<H, W>::recordTo(History* history) {
+	_history = history;
+}
+
+//the frontier is not tracked by default, which keeps forks small. Turning it
+//on builds it from the current state in O(board); from then on every change
+//updates it in O(changed cells), in forks too
+template <int H, int W>
+void BoardState<H, W>::trackFrontier(bool on) {
+	if(on && !_frontier.active())
+		_frontier.build(_grid, _visibility.data());
+	else if(!on)
+		_frontier.clear();
+}
+
+//callback is called with context every few thousand cells of a cascade
+template <int H, int W>
+void BoardState<H, W>::onProgress(ProgressCallback callback, void* context) {
+	_progress = callback;
+	_progress_context = context;
+}
+
+//the game is won once every cell without a bomb has been explored. The
+//explored cells are counted as they are revealed, so this is O(1)
+template <int H, int W>
+bool BoardState<H, W>::won() const {
+	return !_lost && _revealed_cnt == _grid.size()-_bomb_cnt;
+}
+
+template <int H, int W>
+bool BoardState<H, W>::lost() const {
+	return _lost;
+}
+
+template <int H, int W>
+bool BoardState<H, W>::endOfGame() const {
+	return _lost || won();
+}
+
+template <int H, int W>
+int BoardState<H, W>::revealed() const {
+	return _revealed_cnt;
+}
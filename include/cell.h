@@ -1,12 +1,11 @@
 #pragma once
 
 #include <cstdlib>
-#include <ctime>
+#include <random>
 
-#include <GLFW/glfw3.h>
 #include <cmath>
 #include "def.h"
-#include "gui.h"
+#include "profiler.h"
 
 /*
 class cell is defined in this file
@@ -23,12 +22,17 @@ two values: Visibility and content.
 				have access to this value until the cell has been explored. The
 				content is a number that represents the number of bombs around it. 
 				In case the cell is a bomb, then the value is -1.
+
+Both values fit in a byte, so a cell is 2 bytes and a board row stays dense
+in cache. The border ring around every board is made of sentinel cells
+(visibility SENTINEL), which can never be explored, flagged or hold a bomb.
 */
 class Cell
 {
 public:
 	Cell();
 	Cell(int);
+	static Cell sentinel();
 
 	Visibility getVisibility() const;
 	int getContent() const;
@@ -36,21 +40,33 @@ public:
 	Visibility explore();
 	bool flag();
 	bool unflag();
+	void setVisibility(Visibility);
 
-	static void initBoard(std::vector<std::vector<Cell>>& cells, int bomb_cnt);
+	template <class G, class Cells>
+	static void initBoard(Cells& cells, const G& grid, int bomb_cnt, unsigned seed);
+	template <class G, class Cells>
+	static void placeBomb(Cells& cells, const G& grid, int idx);
+	template <class G, class Cells>
+	static void moveBomb(Cells& cells, const G& grid, int from, int to);
 
 private:
 	Visibility _visibility;
-	int _content;	
+	int8_t _content;
 };
 
 
 //cell is initialized with a given content in [-1,8] and Visibility
-Cell::Cell() : _visibility(UNEXPLORED), _content(0) {}
-Cell::Cell(int content) : _visibility(UNEXPLORED), _content(content) {}
+inline Cell::Cell() : _visibility(UNEXPLORED), _content(0) {}
+inline Cell::Cell(int content) : _visibility(UNEXPLORED), _content(content) {}
+
+inline Cell Cell::sentinel() {
+	Cell cell;
+	cell._visibility = SENTINEL;
+	return cell;
+}
 
 //get info of a cell
-int Cell::getContent() const {
+inline int Cell::getContent() const {
 	//only returns the content if the cell has been covered
 	if(_visibility != FREE)
 		return _visibility;
@@ -59,14 +75,14 @@ int Cell::getContent() const {
 }
 
 //returns the visibility of the cell as a enum.
-Visibility Cell::getVisibility() const {
+inline Visibility Cell::getVisibility() const {
 	return _visibility;
 }
 
 //explore a cell, making it available to the player. If the cell has a
 //visibility other than UNEXPLORED, then nothing happens and the current
 //vivibility is returned
-Visibility Cell::explore() {
+inline Visibility Cell::explore() {
 	if(_visibility != UNEXPLORED)
 		return _visibility;
 
@@ -81,7 +97,7 @@ Visibility Cell::explore() {
 }
 
 //flags a cell to represent a bomb. Only useful for the player
-bool Cell::flag() {
+inline bool Cell::flag() {
 	if(_visibility != UNEXPLORED)
 		return false;
 
@@ -90,7 +106,7 @@ bool Cell::flag() {
 }
 
 //removes the flag
-bool Cell::unflag() {
+inline bool Cell::unflag() {
 	if(_visibility != FLAGGED)
 		return false;
 
@@ -98,28 +114,60 @@ bool Cell::unflag() {
 	return true;
 }
 
-void Cell::initBoard(std::vector<std::vector<Cell>>& cells, int bomb_cnt) {
-	int height = (int)cells.size();
-	int width = (int)cells[0].size();
+//puts the cell back in a previous state. Only meant for undo and redo
+inline void Cell::setVisibility(Visibility visibility) {
+	_visibility = visibility;
+}
+
+//places bomb_cnt bombs at random and counts, for every other cell, the bombs
+//around it. cells is the padded storage of a board shaped like grid (see
+//grid.h) and must hold no bombs yet. The same seed always gives the same
+//board, and every call has its own generator, so boards can be generated on
+//several threads at once. The neighbour loop has no edge tests and no branches: sentinels
+//are never bombs and just absorb the increments of the cells next to them
+template <class G, class Cells>
+void Cell::initBoard(Cells& cells, const G& grid, int bomb_cnt, unsigned seed) {
+	PROFILE_SCOPE("Cell::initBoard");
+	int height = grid.height();
+	int width = grid.width();
 
-	std::srand(std::time(0));
+	std::minstd_rand random(seed);
 
 	for (int cnt = 0; cnt < bomb_cnt; cnt++) {
-		int row = std::rand()%height;
-		int col = std::rand()%width;
+		int idx = grid.index(random()%height, random()%width);
 
-		if(cells[row][col]._content == (int)BOMB) {
+		if(cells[idx]._content == (int)BOMB) {
 			cnt--;
 			continue;
 		}
-
-		cells[row][col]._content = (int)BOMB;
-		for (int i = -1; i <= 1; i++)
-			for (int j = -1; j <= 1; j++)
-				if(row+i >= 0 && row+i < height && col+j >= 0 && col+j < width)
-					if(cells[row+i][col+j]._content != (int)BOMB)
-						cells[row+i][col+j]._content++;
-
+		placeBomb(cells, grid, idx);
 	}
 }
 
+//puts a bomb in idx, which must not hold one, and counts it around. Also
+//rebuilds boards stored as a list of bombs (see board_corpus.h)
+template <class G, class Cells>
+void Cell::placeBomb(Cells& cells, const G& grid, int idx) {
+	cells[idx]._content = (int)BOMB;
+	grid.forEachNeighbour(idx, [&](int n) {
+		cells[n]._content += cells[n]._content != (int)BOMB;
+	});
+}
+
+//moves the bomb of from to to, which must not hold one, and updates the counts
+//around both. Like initBoard, the sentinels absorb the changes at the edges
+template <class G, class Cells>
+void Cell::moveBomb(Cells& cells, const G& grid, int from, int to) {
+	int around = 0;
+	grid.forEachNeighbour(from, [&](int n) {
+		bool bomb = cells[n]._content == (int)BOMB;
+		around += bomb;
+		cells[n]._content -= !bomb;
+	});
+	cells[from]._content = around;
+
+	cells[to]._content = (int)BOMB;
+	grid.forEachNeighbour(to, [&](int n) {
+		cells[n]._content += cells[n]._content != (int)BOMB;
+	});
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <utility>
+
+/*
+class Channel is defined in this file
+
+Channel is a small thread-safe FIFO used to hand player moves from the render
+thread, which owns the window and receives the input events, to the logic
+thread, which owns the board. Once closed, pops fail as soon as the queue
+has been drained.
+
+A channel given a capacity is bounded: push waits while it holds that many
+values, so a fast producer can't run ahead of its consumer (see
+minesweeper_gen, whose writer thread drains blocks of boards). Values are
+moved in and out, so a large buffer goes through without a copy.
+*/
+template <typename T>
+class Channel
+{
+public:
+	explicit Channel(size_t capacity = 0);
+
+	void push(const T& value);
+	void push(T&& value);
+	bool pop(T& value, std::chrono::milliseconds timeout);
+	bool tryPop(T& value);
+	void close();
+	bool closed() const;
+
+private:
+	mutable std::mutex _mutex;
+	std::condition_variable _ready;
+	std::condition_variable _space;
+	std::deque<T> _queue;
+	//0 for an unbounded channel
+	size_t _capacity;
+	bool _closed;
+};
+
+
+template <typename T>
+Channel<T>::Channel(size_t capacity) : _capacity(capacity), _closed(false) {}
+
+template <typename T>
+void Channel<T>::push(const T& value) {
+	push(T(value));
+}
+
+//waits for room if the channel is bounded and full. A value pushed after
+//close() is dropped
+template <typename T>
+void Channel<T>::push(T&& value) {
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+		_space.wait(lock, [this] { return _closed || !_capacity || _queue.size() < _capacity; });
+		if(_closed)
+			return;
+		_queue.push_back(std::move(value));
+	}
+	_ready.notify_one();
+}
+
+//waits up to timeout for a value. Returns false if nothing arrived in time or
+//the channel has been closed and drained
+template <typename T>
+bool Channel<T>::pop(T& value, std::chrono::milliseconds timeout) {
+	std::unique_lock<std::mutex> lock(_mutex);
+	if(!_ready.wait_for(lock, timeout, [this] { return _closed || !_queue.empty(); }))
+		return false;
+	if(_queue.empty())
+		return false;
+
+	value = std::move(_queue.front());
+	_queue.pop_front();
+	lock.unlock();
+	_space.notify_one();
+	return true;
+}
+
+template <typename T>
+bool Channel<T>::tryPop(T& value) {
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		if(_queue.empty())
+			return false;
+
+		value = std::move(_queue.front());
+		_queue.pop_front();
+	}
+	_space.notify_one();
+	return true;
+}
+
+template <typename T>
+void Channel<T>::close() {
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_closed = true;
+	}
+	_ready.notify_all();
+	_space.notify_all();
+}
+
+template <typename T>
+bool Channel<T>::closed() const {
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _closed;
+}
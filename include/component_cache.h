@@ -0,0 +1,164 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/*
+the component keys and class ComponentCache are defined in this file
+
+A frontier component (see probability_solver.h) is a group of numbers and
+the unexplored cells around them, connected through the cells they share.
+Its solution, how many bomb placements satisfy all of its numbers and how
+many of them put a bomb on each cell, only depends on the shape of the
+component, not on where it is on the board, and the same shapes come back
+again and again: within a game, as most moves leave most components alone,
+and across games, as the small ones (a lone 1 against a wall, a 1-2 corner...)
+are everywhere.
+
+	code --> what a number contributes to the shape: the bombs it still misses
+				and which of its 8 neighbours are unexplored. It only changes
+				when the number or a neighbour does, so the Zobrist key of
+				every number (ZOBRIST_KEYS[code]) is kept up to date cell by
+				cell, never recomputed for the whole board.
+
+	key --> the exact shape: for every number of the component, in row-major
+				order, its code and its position relative to the first one.
+				Two components with the same key have the same cells (in
+				row-major order) and the same solution.
+
+	hash --> the Zobrist keys of the numbers mixed with their relative
+				positions, combined with xor. It picks the bucket and rejects
+				most mismatches before the keys are compared.
+
+ComponentCache maps shapes to solutions. It is shared by every solver of the
+process (shared()) and safe to use from any thread: the buckets are split in
+COMPONENT_CACHE_STRIPES stripes, each behind its own mutex, so threads only
+wait for each other when they hit the same stripe. Each bucket holds one
+entry and a new one replaces it, so the memory used is bounded: at most
+COMPONENT_CACHE_BUCKETS components of at most COMPONENT_CACHE_MAX_CELLS cells.
+A solution of n cells holds up to (n+1)*(n+1) doubles, 33KB for 64 cells, so
+the cache never holds more than about 136MB, and much less in practice, as
+most components are small.
+Solutions are immutable and handed out as shared pointers, so an entry can be
+replaced while another thread still reads it.
+*/
+#define COMPONENT_CACHE_BUCKETS (1 << 12)
+#define COMPONENT_CACHE_STRIPES 64
+//64 rather than 32: keeping the components of 33 to 64 cells makes the exact
+//solve of a sparse 100x100 board (probability/exact in minesweeper_bench) a
+//third faster
+#define COMPONENT_CACHE_MAX_CELLS 64
+#define COMPONENT_CODES (9*256)
+
+//the solution of a component of cells cells. Both arrays are scaled so that
+//the largest element of ways is 1; log_scale is the log of what they were
+//divided by, for the few uses that need the actual counts
+struct ComponentSolution {
+	int cells, fewest;
+	double log_scale;
+	//ways[k]: the placements with k bombs
+	std::vector<double> ways;
+	//bombs[(k-fewest)*cells+i]: the placements with k bombs that put one on
+	//cell i. There are no rows for the numbers of bombs no placement has
+	//below fewest or after the last row
+	std::vector<double> bombs;
+};
+
+//the finalizer of splitmix64
+constexpr uint64_t mixBits(uint64_t x) {
+	x = (x ^ (x >> 30))*0xbf58476d1ce4e5b9ull;
+	x = (x ^ (x >> 27))*0x94d049bb133111ebull;
+	return x ^ (x >> 31);
+}
+
+struct ZobristKeys {
+	uint64_t keys[COMPONENT_CODES];
+};
+
+constexpr ZobristKeys makeZobristKeys() {
+	ZobristKeys table = {};
+	for (int code = 0; code < COMPONENT_CODES; code++)
+		table.keys[code] = mixBits(0x9e3779b97f4a7c15ull*(code+1));
+	return table;
+}
+
+inline constexpr ZobristKeys ZOBRIST_KEYS = makeZobristKeys();
+
+//code of a number still missing missing bombs among the unexplored
+//neighbours in mask (bit k for the k-th neighbour in row-major order)
+constexpr int componentCode(int missing, int mask) {
+	return missing*256+mask;
+}
+
+//the entry of the key for a number of code code at (row, col) relative to
+//the first number of the component
+inline uint64_t componentKeyEntry(int code, int row, int col) {
+	return uint64_t(row) << 40 | uint64_t(col+(1 << 19)) << 20 | uint64_t(code);
+}
+
+//the share of the hash of a number with Zobrist key zobrist at (row, col)
+//relative to the first number of the component
+inline uint64_t componentHash(uint64_t zobrist, int row, int col) {
+	return mixBits(zobrist+(uint64_t(row) << 32 ^ uint32_t(col))*0x9e3779b97f4a7c15ull);
+}
+
+class ComponentCache
+{
+public:
+	ComponentCache() : _buckets(COMPONENT_CACHE_BUCKETS), _hits(0), _misses(0) {}
+
+	static ComponentCache& shared();
+
+	std::shared_ptr<const ComponentSolution> find(uint64_t hash, const std::vector<uint64_t>& key);
+	void insert(uint64_t hash, const std::vector<uint64_t>& key, std::shared_ptr<const ComponentSolution> solution);
+
+	uint64_t hits() const { return _hits; }
+	uint64_t misses() const { return _misses; }
+
+private:
+	struct Bucket {
+		uint64_t hash;
+		std::vector<uint64_t> key;
+		std::shared_ptr<const ComponentSolution> solution;
+	};
+
+	//a bucket is always behind the same stripe
+	std::mutex& stripe(uint64_t hash) { return _stripes[hash%COMPONENT_CACHE_BUCKETS%COMPONENT_CACHE_STRIPES]; }
+	Bucket& bucket(uint64_t hash) { return _buckets[hash%COMPONENT_CACHE_BUCKETS]; }
+
+	std::vector<Bucket> _buckets;
+	std::mutex _stripes[COMPONENT_CACHE_STRIPES];
+	std::atomic<uint64_t> _hits, _misses;
+};
+
+
+inline ComponentCache& ComponentCache::shared() {
+	static ComponentCache cache;
+	return cache;
+}
+
+//the solution of the component, or nullptr if it is not in the cache
+inline std::shared_ptr<const ComponentSolution> ComponentCache::find(uint64_t hash, const std::vector<uint64_t>& key) {
+	std::lock_guard<std::mutex> lock(stripe(hash));
+	const Bucket& found = bucket(hash);
+	if(found.solution && found.hash == hash && found.key == key) {
+		_hits++;
+		return found.solution;
+	}
+	_misses++;
+	return nullptr;
+}
+
+//components larger than COMPONENT_CACHE_MAX_CELLS are not kept
+inline void ComponentCache::insert(uint64_t hash, const std::vector<uint64_t>& key, std::shared_ptr<const ComponentSolution> solution) {
+	if(solution->cells > COMPONENT_CACHE_MAX_CELLS)
+		return;
+	std::lock_guard<std::mutex> lock(stripe(hash));
+	Bucket& replaced = bucket(hash);
+	replaced.hash = hash;
+	replaced.key = key;
+	replaced.solution = std::move(solution);
+}
@@ -0,0 +1,278 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+#include "def.h"
+#include "component_cache.h"
+
+/*
+struct ComponentProblem and class ComponentSampler are defined in this file
+
+ComponentProblem is a frontier component (see probability_solver.h) the way
+the enumeration and the sampler read it: the numbers around each cell, the
+cells around each number, and the bombs each number misses among how many
+cells.
+
+Some components are too large to enumerate: on big dense boards a frontier
+of a few hundred cells already has more placements than fit in a move.
+ComponentSampler estimates their solution instead, by sequential importance
+sampling (a randomised backtracking that never backtracks):
+
+	sample --> the cells are assigned in row-major order. A cell is a bomb
+				with the share of bombs its numbers miss, on average, among
+				their cells left. After every choice, a number with no bomb
+				left to place, or with as many as it has cells left, forces
+				these cells, and so on. A sample where a number would need
+				more bombs than it has cells left, or fewer than none, is
+				thrown away.
+
+	weight --> one over the probability of drawing the sample. Weighted this
+				way, every placement counts the same, so the weighted counts
+				of the samples estimate those of the enumeration, per number
+				of bombs and per cell.
+
+The threads draw samples until the time budget runs out, each from its own
+generator, and their counts are added at the end. Weights span hundreds of
+orders of magnitude, so every thread keeps them relative to the largest it
+has seen and rescales its counts when a larger one comes.
+
+The result is a ComponentSolution like the enumeration's, plus, for every
+cell, the half width of a 95% confidence interval of its share of bombs in
+the component (delta method for the ratio of the weighted counts). Rows of
+bombs are only kept for the numbers of bombs some sample had.
+*/
+#define SAMPLER_CHECK_EVERY 16
+#define SAMPLER_SHARE_MIN 0.02
+
+struct ComponentProblem {
+	int cells;
+	//numbers[8*cell+k], k < degree[cell]: the numbers around cell, in
+	//increasing order
+	std::vector<int> numbers;
+	std::vector<int> degree;
+	//for each number, the bombs it misses among open of its cells
+	std::vector<int> missing;
+	std::vector<int> open;
+	//members[8*number+m], m < open[number]: the cells around number
+	std::vector<int> members;
+};
+
+class ComponentSampler
+{
+public:
+	explicit ComponentSampler(int threads = 1, unsigned seed = 1) : _threads(std::max(threads, 1)), _seed(seed), _calls(0) {}
+
+	int threads() const { return _threads; }
+	std::shared_ptr<const ComponentSolution> sample(const ComponentProblem& problem, Clock::duration budget, std::vector<float>& error);
+
+private:
+	//the weighted counts of one thread, relative to exp(scale)
+	struct Tally {
+		double scale;
+		long samples;
+		std::vector<double> ways;
+		std::vector<std::vector<double>> bombs;
+		double squares;
+		std::vector<double> square_bombs;
+	};
+
+	static void run(const ComponentProblem& problem, Clock::time_point deadline, std::seed_seq& seeds, Tally& tally);
+	static void rescale(Tally& tally, double scale);
+
+	int _threads;
+	unsigned _seed;
+	unsigned _calls;
+};
+
+
+//estimates the solution of problem within budget, or returns nullptr if no
+//sample made it through. error gets the half width of the 95% confidence
+//interval of every cell
+inline std::shared_ptr<const ComponentSolution> ComponentSampler::sample(const ComponentProblem& problem, Clock::duration budget, std::vector<float>& error) {
+	int cells = problem.cells;
+	Clock::time_point deadline = Clock::now()+budget;
+	std::vector<Tally> tallies(_threads);
+	unsigned call = _calls++;
+
+	auto work = [&](int t) {
+		std::seed_seq seeds = {_seed, call, (unsigned)t};
+		run(problem, deadline, seeds, tallies[t]);
+	};
+	std::vector<std::thread> workers;
+	for (int t = 1; t < _threads; t++)
+		workers.emplace_back(work, t);
+	work(0);
+	for (std::thread& worker : workers)
+		worker.join();
+
+	//all the tallies relative to the largest scale
+	double scale = -INFINITY;
+	for (const Tally& tally : tallies)
+		if(tally.samples)
+			scale = std::max(scale, tally.scale);
+	if(scale == -INFINITY)
+		return nullptr;
+	Tally total = {scale, 0, std::vector<double>(cells+1, 0), std::vector<std::vector<double>>(cells+1), 0, std::vector<double>(cells, 0)};
+	for (Tally& tally : tallies) {
+		if(!tally.samples)
+			continue;
+		rescale(tally, scale);
+		total.samples += tally.samples;
+		total.squares += tally.squares;
+		for (int k = 0; k <= cells; k++) {
+			total.ways[k] += tally.ways[k];
+			if(tally.bombs[k].empty())
+				continue;
+			total.bombs[k].resize(cells, 0);
+			for (int i = 0; i < cells; i++)
+				total.bombs[k][i] += tally.bombs[k][i];
+		}
+		for (int i = 0; i < cells; i++)
+			total.square_bombs[i] += tally.square_bombs[i];
+	}
+
+	auto solution = std::make_shared<ComponentSolution>();
+	solution->cells = cells;
+	solution->ways = total.ways;
+	int fewest = 0, most = cells;
+	while(total.bombs[fewest].empty())
+		fewest++;
+	while(total.bombs[most].empty())
+		most--;
+	solution->fewest = fewest;
+	solution->bombs.assign((most-fewest+1)*cells, 0);
+	for (int k = fewest; k <= most; k++)
+		if(!total.bombs[k].empty())
+			std::copy(total.bombs[k].begin(), total.bombs[k].end(), solution->bombs.begin()+(k-fewest)*cells);
+
+	//the share of bombs of cell i is A/W, with A and W the weighted counts
+	//of the samples with a bomb there and of all of them. Its variance is
+	//about the sum over samples of (w(x_i-A/W))^2, over W^2
+	double sum = 0;
+	for (double ways : total.ways)
+		sum += ways;
+	error.assign(cells, 0);
+	for (int i = 0; i < cells; i++) {
+		double bombs = 0;
+		for (int k = fewest; k <= most; k++)
+			bombs += solution->bombs[(k-fewest)*cells+i];
+		double share = bombs/sum;
+		double variance = (total.square_bombs[i]*(1-2*share)+share*share*total.squares)/(sum*sum);
+		error[i] = float(1.96*std::sqrt(std::max(variance, 0.0)));
+	}
+
+	double largest = *std::max_element(solution->ways.begin(), solution->ways.end());
+	solution->log_scale = scale+std::log(largest);
+	for (double& ways : solution->ways)
+		ways /= largest;
+	for (double& bombs : solution->bombs)
+		bombs /= largest;
+	return solution;
+}
+
+//draws samples until deadline
+inline void ComponentSampler::run(const ComponentProblem& problem, Clock::time_point deadline, std::seed_seq& seeds, Tally& tally) {
+	int cells = problem.cells, numbers = (int)problem.missing.size();
+	tally = {0, 0, std::vector<double>(cells+1, 0), std::vector<std::vector<double>>(cells+1), 0, std::vector<double>(cells, 0)};
+	std::mt19937_64 random(seeds);
+	std::uniform_real_distribution<double> uniform(0, 1);
+	std::vector<int> missing, open, forcing;
+	std::vector<int8_t> assignment;
+
+	//gives cell its value and queues the numbers that now force their
+	//other cells. Returns false if a number can no longer be satisfied
+	auto assign = [&](int cell, int value) {
+		assignment[cell] = value;
+		bool fits = true;
+		for (int k = 0; k < problem.degree[cell]; k++) {
+			int number = problem.numbers[8*cell+k];
+			open[number]--;
+			missing[number] -= value;
+			fits &= missing[number] >= 0 && missing[number] <= open[number];
+			if(open[number] && (missing[number] == 0 || missing[number] == open[number]))
+				forcing.push_back(number);
+		}
+		return fits;
+	};
+	auto propagate = [&]() {
+		bool fits = true;
+		while(fits && !forcing.empty()) {
+			int number = forcing.back();
+			forcing.pop_back();
+			int value = missing[number] > 0;
+			for (int m = 0; m < problem.open[number] && fits; m++) {
+				int cell = problem.members[8*number+m];
+				if(assignment[cell] < 0)
+					fits = assign(cell, value);
+			}
+		}
+		return fits;
+	};
+
+	for (long drawn = 0; drawn%SAMPLER_CHECK_EVERY || Clock::now() < deadline; drawn++) {
+		missing = problem.missing;
+		open = problem.open;
+		assignment.assign(cells, -1);
+		forcing.clear();
+		for (int number = 0; number < numbers; number++)
+			if(missing[number] == 0 || missing[number] == open[number])
+				forcing.push_back(number);
+		bool fits = propagate();
+		double log_weight = 0;
+
+		for (int cell = 0; cell < cells && fits; cell++) {
+			if(assignment[cell] >= 0)
+				continue;
+			double share = 0;
+			for (int k = 0; k < problem.degree[cell]; k++) {
+				int number = problem.numbers[8*cell+k];
+				share += double(missing[number])/open[number];
+			}
+			share = std::min(std::max(share/problem.degree[cell], SAMPLER_SHARE_MIN), 1-SAMPLER_SHARE_MIN);
+			int value = uniform(random) < share;
+			log_weight -= std::log(value ? share : 1-share);
+			fits = assign(cell, value) && propagate();
+		}
+		if(!fits)
+			continue;
+
+		int bombs = 0;
+		for (int cell = 0; cell < cells; cell++)
+			bombs += assignment[cell];
+		if(!tally.samples || log_weight > tally.scale)
+			rescale(tally, log_weight);
+		tally.samples++;
+		double weight = std::exp(log_weight-tally.scale), square = weight*weight;
+		tally.ways[bombs] += weight;
+		tally.squares += square;
+		std::vector<double>& row = tally.bombs[bombs];
+		row.resize(cells, 0);
+		for (int i = 0; i < cells; i++) {
+			row[i] += assignment[i]*weight;
+			tally.square_bombs[i] += assignment[i]*square;
+		}
+	}
+}
+
+//makes the counts of tally relative to exp(scale) instead
+inline void ComponentSampler::rescale(Tally& tally, double scale) {
+	if(!tally.samples) {
+		tally.scale = scale;
+		return;
+	}
+	double factor = std::exp(tally.scale-scale), square = factor*factor;
+	for (double& ways : tally.ways)
+		ways *= factor;
+	for (std::vector<double>& row : tally.bombs)
+		for (double& bombs : row)
+			bombs *= factor;
+	tally.squares *= square;
+	for (double& bombs : tally.square_bombs)
+		bombs *= square;
+	tally.scale = scale;
+}
@@ -0,0 +1,331 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <numeric>
+#include <tuple>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "def.h"
+#include "cell.h"
+#include "grid.h"
+#include "board_analysis.h"
+#include "board_corpus.h"
+
+/*
+struct CorpusIndexHeader and classes CorpusIndexWriter and CorpusIndex are
+defined in this file
+
+An indexed corpus holds boards of any size with their grades (see
+board_analysis.h), laid out to be queried in place through mmap, without
+reading the boards. After a CorpusIndexHeader, the file is made of
+sections, each a plain array starting on 8 bytes, one entry per board
+unless said otherwise:
+
+	bitmaps --> the bombs of every board, packed by packBombs() (see
+				board_corpus.h), one after the other.
+
+	columns --> the metadata of the boards, one array per field: where its
+				bits start in the bitmaps (8 bytes), its seed (4), height and
+				width (2 each), bomb count, 3BV and openings (4 each) and
+				whether it is guess-free (1).
+
+	indexes --> for 3BV and for openings, the numbers of all the boards (4
+				bytes each) sorted by height, width, bomb count and then the
+				metric. The boards of a size with the metric within bounds are
+				a contiguous run of the index, found by binary search.
+
+A query like "expert boards with 3BV between 120 and 130" is a range(), two
+binary searches over the 3BV index, and its boards are read column by column
+as they are needed. board() rebuilds the padded layout of one of them, the
+layout the engine plays on.
+
+CorpusIndexWriter streams the bitmaps to the file as boards are added and
+keeps the columns in memory (33 bytes a board) until close(), which sorts
+the indexes and writes them after the columns. The header is rewritten last,
+so a file cut short is never taken for a corpus. A corpus holds up to 2^32
+boards and is in the byte order of the machine that wrote it.
+
+CorpusIndex::open() checks the whole file once, so that nothing read through
+the mapping afterwards can fall outside it: every section is large enough
+for the boards, every board number of the indexes is a board, and every
+bitmap is inside the bitmaps.
+*/
+#define CORPUS_INDEX_MAGIC "MSCINDEX"
+#define CORPUS_INDEX_VERSION 1
+
+//the sections of an indexed corpus, in file order
+enum CorpusSection {
+	SECTION_BITMAPS,
+	SECTION_BITMAP_AT,
+	SECTION_SEEDS,
+	SECTION_HEIGHTS,
+	SECTION_WIDTHS,
+	SECTION_BOMB_CNTS,
+	SECTION_BBBVS,
+	SECTION_OPENINGS,
+	SECTION_GUESS_FREE,
+	SECTION_BY_BBBV,
+	SECTION_BY_OPENINGS,
+	CORPUS_SECTIONS
+};
+
+//the metrics with an index
+enum CorpusMetric {METRIC_BBBV, METRIC_OPENINGS};
+
+struct CorpusIndexHeader {
+	char magic[8];
+	uint32_t version;
+	uint32_t sections;
+	uint64_t count;
+	//section s is the bytes [offsets[s], offsets[s+1]) of the file
+	uint64_t offsets[CORPUS_SECTIONS+1];
+};
+
+//a run of board numbers of an index
+struct CorpusRange {
+	const uint32_t* first;
+	const uint32_t* last;
+
+	const uint32_t* begin() const { return first; }
+	const uint32_t* end() const { return last; }
+	size_t size() const { return last-first; }
+};
+
+class CorpusIndexWriter
+{
+public:
+	CorpusIndexWriter() : _file(nullptr), _bitmap_bytes(0), _failed(false) {}
+	~CorpusIndexWriter() { close(); }
+
+	bool open(const char* path);
+	void add(int height, int width, int bomb_cnt, unsigned seed, const uint8_t* bits, const BoardMetrics& metrics);
+	bool close();
+
+private:
+	template <typename T> void writeSection(CorpusSection section, const std::vector<T>& column, CorpusIndexHeader& header);
+	std::vector<uint32_t> sortBy(const std::vector<uint32_t>& metric) const;
+
+	std::FILE* _file;
+	uint64_t _bitmap_bytes;
+	bool _failed;
+	std::vector<uint64_t> _bitmap_at;
+	std::vector<uint32_t> _seeds;
+	std::vector<uint16_t> _heights, _widths;
+	std::vector<uint32_t> _bomb_cnts, _bbbvs, _openings;
+	std::vector<uint8_t> _guess_free;
+};
+
+class CorpusIndex
+{
+public:
+	CorpusIndex() : _data(nullptr), _size(0), _header(nullptr) {}
+	~CorpusIndex() { close(); }
+	CorpusIndex(const CorpusIndex&) = delete;
+	CorpusIndex& operator=(const CorpusIndex&) = delete;
+
+	bool open(const char* path);
+	void close();
+
+	uint64_t count() const { return _header->count; }
+	unsigned seed(uint32_t board) const { return column<uint32_t>(SECTION_SEEDS)[board]; }
+	int height(uint32_t board) const { return column<uint16_t>(SECTION_HEIGHTS)[board]; }
+	int width(uint32_t board) const { return column<uint16_t>(SECTION_WIDTHS)[board]; }
+	int bombCnt(uint32_t board) const { return column<uint32_t>(SECTION_BOMB_CNTS)[board]; }
+	int bbbv(uint32_t board) const { return column<uint32_t>(SECTION_BBBVS)[board]; }
+	int openings(uint32_t board) const { return column<uint32_t>(SECTION_OPENINGS)[board]; }
+	bool guessFree(uint32_t board) const { return column<uint8_t>(SECTION_GUESS_FREE)[board]; }
+	const uint8_t* bits(uint32_t board) const { return column<uint8_t>(SECTION_BITMAPS)+column<uint64_t>(SECTION_BITMAP_AT)[board]; }
+
+	CorpusRange range(CorpusMetric metric, int height, int width, int bomb_cnt, int low, int high) const;
+	template <int H, int W> void board(uint32_t board, const Grid<H, W>& grid, typename Grid<H, W>::template Array<Cell>& layout) const;
+
+private:
+	bool entriesValid() const;
+
+	template <typename T> const T* column(CorpusSection section) const {
+		return reinterpret_cast<const T*>(_data+_header->offsets[section]);
+	}
+
+	const uint8_t* _data;
+	size_t _size;
+	const CorpusIndexHeader* _header;
+};
+
+
+/*************************************************************************
+CorpusIndexWriter
+*************************************************************************/
+
+//creates the file and leaves room for the header
+inline bool CorpusIndexWriter::open(const char* path) {
+	_file = std::fopen(path, "wb");
+	if(!_file)
+		return false;
+	CorpusIndexHeader header = {};
+	_failed = std::fwrite(&header, sizeof(header), 1, _file) != 1;
+	return !_failed;
+}
+
+//appends a board, bits being its bombs as packed by packBombs()
+inline void CorpusIndexWriter::add(int height, int width, int bomb_cnt, unsigned seed, const uint8_t* bits, const BoardMetrics& metrics) {
+	size_t bytes = (height*width+7)/8;
+	_failed |= std::fwrite(bits, 1, bytes, _file) != bytes;
+	_bitmap_at.push_back(_bitmap_bytes);
+	_bitmap_bytes += bytes;
+	_seeds.push_back(seed);
+	_heights.push_back(height);
+	_widths.push_back(width);
+	_bomb_cnts.push_back(bomb_cnt);
+	_bbbvs.push_back(metrics.bbbv);
+	_openings.push_back(metrics.openings);
+	_guess_free.push_back(metrics.guessing == 0);
+}
+
+//the numbers of the boards sorted by size and then by metric
+inline std::vector<uint32_t> CorpusIndexWriter::sortBy(const std::vector<uint32_t>& metric) const {
+	std::vector<uint32_t> boards(_seeds.size());
+	std::iota(boards.begin(), boards.end(), 0);
+	std::sort(boards.begin(), boards.end(), [&](uint32_t a, uint32_t b) {
+		return std::make_tuple(_heights[a], _widths[a], _bomb_cnts[a], metric[a], a) <
+			   std::make_tuple(_heights[b], _widths[b], _bomb_cnts[b], metric[b], b);
+	});
+	return boards;
+}
+
+//pads the file to 8 bytes and writes column as section
+template <typename T>
+void CorpusIndexWriter::writeSection(CorpusSection section, const std::vector<T>& column, CorpusIndexHeader& header) {
+	static const uint8_t padding[8] = {};
+	uint64_t at = header.offsets[section];
+	uint64_t aligned = (at+7) & ~(uint64_t)7;
+	_failed |= std::fwrite(padding, 1, aligned-at, _file) != aligned-at;
+	_failed |= std::fwrite(column.data(), sizeof(T), column.size(), _file) != column.size();
+	header.offsets[section] = aligned;
+	header.offsets[section+1] = aligned+column.size()*sizeof(T);
+}
+
+//writes the columns, the indexes and the header, and closes the file.
+//Returns false if any write failed
+inline bool CorpusIndexWriter::close() {
+	if(!_file)
+		return !_failed;
+
+	CorpusIndexHeader header = {};
+	std::memcpy(header.magic, CORPUS_INDEX_MAGIC, sizeof(header.magic));
+	header.version = CORPUS_INDEX_VERSION;
+	header.sections = CORPUS_SECTIONS;
+	header.count = _seeds.size();
+	header.offsets[SECTION_BITMAPS] = sizeof(header);
+	header.offsets[SECTION_BITMAP_AT] = sizeof(header)+_bitmap_bytes;
+	writeSection(SECTION_BITMAP_AT, _bitmap_at, header);
+	writeSection(SECTION_SEEDS, _seeds, header);
+	writeSection(SECTION_HEIGHTS, _heights, header);
+	writeSection(SECTION_WIDTHS, _widths, header);
+	writeSection(SECTION_BOMB_CNTS, _bomb_cnts, header);
+	writeSection(SECTION_BBBVS, _bbbvs, header);
+	writeSection(SECTION_OPENINGS, _openings, header);
+	writeSection(SECTION_GUESS_FREE, _guess_free, header);
+	writeSection(SECTION_BY_BBBV, sortBy(_bbbvs), header);
+	writeSection(SECTION_BY_OPENINGS, sortBy(_openings), header);
+
+	_failed |= std::fseek(_file, 0, SEEK_SET) != 0;
+	_failed |= std::fwrite(&header, sizeof(header), 1, _file) != 1;
+	_failed |= std::fclose(_file) != 0;
+	_file = nullptr;
+	return !_failed;
+}
+
+
+/*************************************************************************
+CorpusIndex
+*************************************************************************/
+
+//maps the file and checks its header, its sections and their entries
+inline bool CorpusIndex::open(const char* path) {
+	close();
+	int fd = ::open(path, O_RDONLY);
+	if(fd < 0)
+		return false;
+	struct stat info;
+	if(fstat(fd, &info) || (size_t)info.st_size < sizeof(CorpusIndexHeader)) {
+		::close(fd);
+		return false;
+	}
+	void* data = mmap(nullptr, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	::close(fd);
+	if(data == MAP_FAILED)
+		return false;
+	_data = static_cast<const uint8_t*>(data);
+	_size = info.st_size;
+	_header = reinterpret_cast<const CorpusIndexHeader*>(_data);
+
+	bool valid = !std::memcmp(_header->magic, CORPUS_INDEX_MAGIC, sizeof(_header->magic)) && _header->version == CORPUS_INDEX_VERSION &&
+				 _header->sections == CORPUS_SECTIONS && _header->offsets[CORPUS_SECTIONS] <= _size &&
+				 _header->count <= (uint64_t)1 << 32;
+	//the bytes of an entry of every section, the bitmaps having none
+	static const int entry[CORPUS_SECTIONS] = {0, 8, 4, 2, 2, 4, 4, 4, 1, 4, 4};
+	for (int s = 0; s < CORPUS_SECTIONS && valid; s++)
+		valid = _header->offsets[s] <= _header->offsets[s+1] && _header->offsets[s] % (s == SECTION_BITMAPS ? 1 : 8) == 0 &&
+				_header->offsets[s+1]-_header->offsets[s] >= _header->count*entry[s];
+	if(!valid || !entriesValid()) {
+		close();
+		return false;
+	}
+	return true;
+}
+
+//one pass over the indexes and the bitmap offsets, once the sections are
+//known to hold every board
+inline bool CorpusIndex::entriesValid() const {
+	const uint32_t* by_bbbv = column<uint32_t>(SECTION_BY_BBBV);
+	const uint32_t* by_openings = column<uint32_t>(SECTION_BY_OPENINGS);
+	const uint64_t* bitmap_at = column<uint64_t>(SECTION_BITMAP_AT);
+	uint64_t bitmap_bytes = _header->offsets[SECTION_BITMAPS+1]-_header->offsets[SECTION_BITMAPS];
+	for (uint64_t b = 0; b < count(); b++) {
+		if(by_bbbv[b] >= count() || by_openings[b] >= count())
+			return false;
+		uint64_t bytes = ((uint64_t)height(b)*width(b)+7)/8;
+		if(bitmap_at[b] > bitmap_bytes || bytes > bitmap_bytes-bitmap_at[b])
+			return false;
+	}
+	return true;
+}
+
+inline void CorpusIndex::close() {
+	if(_data)
+		munmap(const_cast<uint8_t*>(_data), _size);
+	_data = nullptr;
+	_size = 0;
+	_header = nullptr;
+}
+
+//the boards of the given size whose metric is in [low, high], in order of
+//the metric
+inline CorpusRange CorpusIndex::range(CorpusMetric metric, int height, int width, int bomb_cnt, int low, int high) const {
+	const uint32_t* values = column<uint32_t>(metric == METRIC_BBBV ? SECTION_BBBVS : SECTION_OPENINGS);
+	const uint32_t* index = column<uint32_t>(metric == METRIC_BBBV ? SECTION_BY_BBBV : SECTION_BY_OPENINGS);
+	const uint16_t* heights = column<uint16_t>(SECTION_HEIGHTS);
+	const uint16_t* widths = column<uint16_t>(SECTION_WIDTHS);
+	const uint32_t* bomb_cnts = column<uint32_t>(SECTION_BOMB_CNTS);
+	auto key = [&](uint32_t board) { return std::make_tuple((int)heights[board], (int)widths[board], (int)bomb_cnts[board], (int64_t)values[board]); };
+
+	if(low > high)
+		return {index, index};
+	auto lower = std::make_tuple(height, width, bomb_cnt, (int64_t)low);
+	auto upper = std::make_tuple(height, width, bomb_cnt, (int64_t)high);
+	const uint32_t* first = std::partition_point(index, index+count(), [&](uint32_t board) { return key(board) < lower; });
+	const uint32_t* last = std::partition_point(first, index+count(), [&](uint32_t board) { return key(board) <= upper; });
+	return {first, last};
+}
+
+//rebuilds the layout of board, whose size must be that of grid
+template <int H, int W>
+void CorpusIndex::board(uint32_t board, const Grid<H, W>& grid, typename Grid<H, W>::template Array<Cell>& layout) const {
+	unpackBombs(grid, bits(board), layout);
+}
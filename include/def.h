@@ -1,11 +1,39 @@
 #pragma once
 
+#include <chrono>
+#include <cstdint>
+
 #define SQUARE_SIZE 60
 #define SHADE 0.1
 #define FLAG_X 0.45
 #define FLAG_Y 0.3
 #define FLAG 0.1
 
-enum Visibility {FREE=0, BOMB=-1, UNEXPLORED=-2, FLAGGED=-3};
-enum MouseButton {RIGHT=0, LEFT=1};
-class Board;
+//SENTINEL marks the inert border ring around every board (see grid.h)
+enum Visibility : int8_t {FREE=0, BOMB=-1, UNEXPLORED=-2, FLAGGED=-3, SENTINEL=-4};
+//MIDDLE is the chord action: a middle click, or left and right held together.
+//UNDO and REDO come from the keyboard (Ctrl+Z, Ctrl+Y) but travel to the logic
+//thread the same way, with no cell attached
+enum MouseButton {RIGHT=0, LEFT=1, MIDDLE=2, UNDO=3, REDO=4};
+
+typedef std::chrono::steady_clock Clock;
+
+//a click on the board, passed from the render thread to the logic thread.
+//pressed and applied are the first two latency timestamps (see latency.h),
+//frame is the sequence number of the first snapshot that includes it
+struct Move {
+	int row, col;
+	MouseButton button;
+	Clock::time_point pressed, applied;
+	unsigned frame;
+};
+
+//one move on a board without a window, made by a VectorEnv agent or a Solver.
+//button is LEFT (explore), RIGHT (flag or unflag) or MIDDLE (chord); anything
+//else is a no-op
+struct Action {
+	int row, col;
+	MouseButton button;
+};
+
+template <int H, int W> class Board;
@@ -0,0 +1,425 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+#include "def.h"
+#include "solver.h"
+#include "pattern_solver.h"
+
+/*
+classes ConstraintSystem and EliminationSolver are defined in this file
+
+Every explored number is a linear equation over the unexplored cells around
+it: their sum, counting a bomb as 1 and a safe cell as 0, is the number minus
+the bombs already known around it. ConstraintSystem keeps all of these
+equations and combines them the way Gauss-Jordan elimination would, looking
+after every change for an equation that forces its cells:
+
+	a + b - c = 2 --> the largest value the left side can take is 2, so a
+				and b are bombs and c is safe.
+
+	a - b = -1 --> the smallest value is -1, so a is safe and b is a bomb.
+
+This finds everything the single-cell and subset rules find, and the chains
+of overlapping numbers (the 1-2-1 and 1-2-2-1 patterns and their longer
+relatives) they miss, without enumerating any configuration.
+
+Coefficients are kept to -1, 0 and 1, so an equation is two bitsets over the
+cells of the board, plus and minus, and combining two of them is a few word
+operations per 64 cells. Two equations whose combination would need a
+coefficient of 2 are simply not combined; every equation kept is still true,
+the system is just not always fully reduced.
+
+The system is never rebuilt during a game. Every move only assigns the
+cells it revealed or flagged and adds the equations of the newly explored
+numbers; only the equations these touch are reduced again. Assigned cells
+are taken out of the equations in one pass over all of them, however many
+cells a cascade revealed.
+
+	pivot --> every reduced equation owns one of its cells, its pivot, and
+				the other equations are combined with it to remove that cell.
+				A new equation starts by removing the pivots it holds.
+
+	dirty --> the equations changed since they were last reduced and checked.
+*/
+class ConstraintSystem
+{
+public:
+	void reset(int cells);
+	int known(int cell) const { return _value[cell]; }
+	void assign(int cell, int value);
+	void add(const int* cells, int count, int sum);
+	void eliminate(std::vector<int>& forced);
+
+private:
+	struct Equation {
+		std::vector<uint64_t> plus, minus;
+		int sum;
+		int pivot;
+		bool live, dirty;
+	};
+
+	bool holds(const Equation& e, int cell) const { return (e.plus[cell >> 6] | e.minus[cell >> 6]) >> (cell & 63) & 1; }
+	void substitute();
+	void touch(int e);
+	void drop(int e);
+	bool combine(int e, int with, int cell);
+	void reduce(int e);
+	void choosePivot(int e);
+	void check(int e, std::vector<int>& forced);
+
+	int _words;
+	std::vector<int8_t> _value;
+	//cells assigned since the last substitute(), and which of them are bombs
+	std::vector<uint64_t> _assigned;
+	std::vector<uint64_t> _bombs;
+	bool _pending;
+	std::vector<int> _pivot_of;
+	std::vector<Equation> _equations;
+	std::vector<int> _free;
+	std::vector<int> _dirty;
+};
+
+/*
+EliminationSolver plays the single-cell moves first, as they come with
+chords, then the pair patterns (see pattern_solver.h), then the cells the
+constraint system forces, and guesses only when none has anything left.
+Every move keeps the system up to date, but it is only reduced when the
+cheaper stages find nothing.
+*/
+class EliminationSolver : public PatternSolver
+{
+public:
+	explicit EliminationSolver(unsigned seed) : PatternSolver(seed) {}
+
+	const char* name() const override { return "elimination"; }
+	void newGame(int height, int width, int bomb_cnt) override;
+	Action nextMove(const Observation& board) override;
+
+private:
+	void sync(const Observation& board);
+
+	ConstraintSystem _system;
+	std::vector<int8_t> _seen;
+	std::vector<int> _changed;
+	std::vector<int> _forced;
+};
+
+inline void registerEliminationSolver() {
+	registerSolver("elimination", [](unsigned seed) { return std::unique_ptr<Solver>(new EliminationSolver(seed)); });
+}
+
+
+/*************************************************************************
+ConstraintSystem
+*************************************************************************/
+
+//forgets every equation, for a board of cells cells all unknown
+inline void ConstraintSystem::reset(int cells) {
+	_words = (cells+63)/64;
+	_value.assign(cells, -1);
+	_assigned.assign(_words, 0);
+	_bombs.assign(_words, 0);
+	_pending = false;
+	_pivot_of.assign(cells, -1);
+	_equations.clear();
+	_free.clear();
+	_dirty.clear();
+}
+
+//the value of cell is now known: 1 for a bomb, 0 for a safe cell. It is
+//taken out of the equations holding it before they are next used
+inline void ConstraintSystem::assign(int cell, int value) {
+	if(_value[cell] >= 0)
+		return;
+	_value[cell] = value;
+
+	uint64_t bit = uint64_t(1) << (cell & 63);
+	_assigned[cell >> 6] |= bit;
+	_bombs[cell >> 6] |= value ? bit : 0;
+	_pending = true;
+}
+
+//takes every cell assigned since the last call out of the equations
+inline void ConstraintSystem::substitute() {
+	if(!_pending)
+		return;
+
+	for (int e = 0; e < (int)_equations.size(); e++) {
+		Equation& equation = _equations[e];
+		if(!equation.live)
+			continue;
+		bool changed = false;
+		for (int w = 0; w < _words; w++) {
+			uint64_t plus = equation.plus[w] & _assigned[w], minus = equation.minus[w] & _assigned[w];
+			if(!(plus | minus))
+				continue;
+			equation.sum -= __builtin_popcountll(plus & _bombs[w])-__builtin_popcountll(minus & _bombs[w]);
+			equation.plus[w] &= ~plus;
+			equation.minus[w] &= ~minus;
+			changed = true;
+		}
+		if(changed)
+			touch(e);
+	}
+
+	std::fill(_assigned.begin(), _assigned.end(), 0);
+	std::fill(_bombs.begin(), _bombs.end(), 0);
+	_pending = false;
+}
+
+//adds the equation "the sum of cells[0..count) is sum". The cells must all
+//be unknown
+inline void ConstraintSystem::add(const int* cells, int count, int sum) {
+	int e;
+	if(_free.empty()) {
+		e = (int)_equations.size();
+		_equations.emplace_back();
+	}
+	else {
+		e = _free.back();
+		_free.pop_back();
+	}
+
+	Equation& equation = _equations[e];
+	equation.plus.assign(_words, 0);
+	equation.minus.assign(_words, 0);
+	for (int i = 0; i < count; i++)
+		equation.plus[cells[i] >> 6] |= uint64_t(1) << (cells[i] & 63);
+	equation.sum = sum;
+	equation.pivot = -1;
+	equation.live = true;
+	equation.dirty = false;
+	touch(e);
+}
+
+//brings every changed equation back to reduced form and appends to forced
+//the cells found to be bombs or safe, which are assigned on the way (read
+//their value with known())
+inline void ConstraintSystem::eliminate(std::vector<int>& forced) {
+	for (substitute(); !_dirty.empty(); substitute()) {
+		int e = _dirty.back();
+		_dirty.pop_back();
+		_equations[e].dirty = false;
+		if(!_equations[e].live)
+			continue;
+
+		if(_equations[e].pivot < 0) {
+			reduce(e);
+			choosePivot(e);
+		}
+		check(e, forced);
+	}
+}
+
+//marks an equation changed. One that lost its pivot gives it up
+inline void ConstraintSystem::touch(int e) {
+	Equation& equation = _equations[e];
+	if(equation.pivot >= 0 && !holds(equation, equation.pivot)) {
+		_pivot_of[equation.pivot] = -1;
+		equation.pivot = -1;
+	}
+	if(!equation.dirty) {
+		equation.dirty = true;
+		_dirty.push_back(e);
+	}
+}
+
+inline void ConstraintSystem::drop(int e) {
+	Equation& equation = _equations[e];
+	if(equation.pivot >= 0)
+		_pivot_of[equation.pivot] = -1;
+	equation.pivot = -1;
+	equation.live = false;
+	_free.push_back(e);
+}
+
+//removes cell from equation e by adding or subtracting equation with, which
+//holds it too. Returns false, changing nothing, if that would need a
+//coefficient of 2
+inline bool ConstraintSystem::combine(int e, int with, int cell) {
+	Equation& target = _equations[e];
+	const Equation& source = _equations[with];
+	uint64_t bit = uint64_t(1) << (cell & 63);
+	bool same = !!(target.plus[cell >> 6] & bit) == !!(source.plus[cell >> 6] & bit);
+
+	//subtracting source is adding it with plus and minus swapped
+	const std::vector<uint64_t>& add_plus = same ? source.minus : source.plus;
+	const std::vector<uint64_t>& add_minus = same ? source.plus : source.minus;
+	for (int w = 0; w < _words; w++)
+		if((target.plus[w] & add_plus[w]) | (target.minus[w] & add_minus[w]))
+			return false;
+
+	for (int w = 0; w < _words; w++) {
+		uint64_t plus = (target.plus[w] & ~add_minus[w]) | (add_plus[w] & ~target.minus[w]);
+		uint64_t minus = (target.minus[w] & ~add_plus[w]) | (add_minus[w] & ~target.plus[w]);
+		target.plus[w] = plus;
+		target.minus[w] = minus;
+	}
+	target.sum += same ? -source.sum : source.sum;
+	return true;
+}
+
+//removes from equation e the pivots of the other equations
+inline void ConstraintSystem::reduce(int e) {
+	for (int w = 0; w < _words; w++) {
+		uint64_t tried = 0;
+		for (;;) {
+			const Equation& equation = _equations[e];
+			uint64_t candidates = (equation.plus[w] | equation.minus[w]) & ~tried;
+			int cell = -1;
+			while(candidates) {
+				int c = w*64+__builtin_ctzll(candidates);
+				candidates &= candidates-1;
+				if(_pivot_of[c] >= 0 && _pivot_of[c] != e) {
+					cell = c;
+					break;
+				}
+			}
+			if(cell < 0)
+				break;
+			tried |= uint64_t(1) << (cell & 63);
+			combine(e, _pivot_of[cell], cell);
+		}
+	}
+}
+
+//gives equation e the first of its cells no other equation owns, and removes
+//that cell from every other equation
+inline void ConstraintSystem::choosePivot(int e) {
+	for (int w = 0; w < _words && _equations[e].pivot < 0; w++) {
+		uint64_t cells = _equations[e].plus[w] | _equations[e].minus[w];
+		while(cells) {
+			int cell = w*64+__builtin_ctzll(cells);
+			cells &= cells-1;
+			if(_pivot_of[cell] < 0) {
+				_equations[e].pivot = cell;
+				_pivot_of[cell] = e;
+				break;
+			}
+		}
+	}
+
+	int pivot = _equations[e].pivot;
+	if(pivot < 0)
+		return;
+	for (int other = 0; other < (int)_equations.size(); other++)
+		if(other != e && _equations[other].live && holds(_equations[other], pivot) && combine(other, e, pivot))
+			touch(other);
+}
+
+//drops an equation with no cells left, and assigns the cells of one that
+//can only be satisfied one way
+inline void ConstraintSystem::check(int e, std::vector<int>& forced) {
+	Equation& equation = _equations[e];
+	int plus = 0, minus = 0;
+	for (int w = 0; w < _words; w++) {
+		plus += __builtin_popcountll(equation.plus[w]);
+		minus += __builtin_popcountll(equation.minus[w]);
+	}
+
+	int plus_value;
+	if(plus+minus == 0) {
+		drop(e);
+		return;
+	}
+	if(equation.sum == plus)
+		plus_value = 1;
+	else if(equation.sum == -minus)
+		plus_value = 0;
+	else
+		return;
+
+	//assigning changes the equations, so the cells are read off a copy
+	std::vector<uint64_t> plus_cells = equation.plus, minus_cells = equation.minus;
+	for (int w = 0; w < _words; w++)
+		for (int sign = 0; sign < 2; sign++) {
+			uint64_t cells = sign ? minus_cells[w] : plus_cells[w];
+			while(cells) {
+				int cell = w*64+__builtin_ctzll(cells);
+				cells &= cells-1;
+				assign(cell, sign ? 1-plus_value : plus_value);
+				forced.push_back(cell);
+			}
+		}
+}
+
+
+/*************************************************************************
+EliminationSolver
+*************************************************************************/
+
+inline void EliminationSolver::newGame(int height, int width, int bomb_cnt) {
+	_system.reset(height*width);
+	_seen.assign(height*width, UNEXPLORED);
+	_forced.clear();
+}
+
+inline Action EliminationSolver::nextMove(const Observation& board) {
+	sync(board);
+
+	Action action;
+	if(deduce(board, action) || matchPatterns(board, action))
+		return action;
+
+	for (int pass = 0; pass < 2; pass++) {
+		while(!_forced.empty()) {
+			int cell = _forced.back();
+			_forced.pop_back();
+			if(board.contents[cell] == UNEXPLORED)
+				return {cell/board.width, cell%board.width, _system.known(cell) ? RIGHT : LEFT};
+		}
+		if(pass == 0)
+			_system.eliminate(_forced);
+	}
+	return guess(board);
+}
+
+//brings the system up to date with what changed on the board since the last
+//move. A cell covered again (a new game, an undo) starts it over
+inline void EliminationSolver::sync(const Observation& board) {
+	int cells = board.height*board.width;
+	if((int)_seen.size() != cells)
+		newGame(board.height, board.width, board.bomb_cnt);
+
+	_changed.clear();
+	for (int idx = 0; idx < cells; idx++) {
+		if(_seen[idx] == board.contents[idx])
+			continue;
+		if(board.contents[idx] == UNEXPLORED) {
+			newGame(board.height, board.width, board.bomb_cnt);
+			sync(board);
+			return;
+		}
+		_changed.push_back(idx);
+	}
+
+	for (int idx : _changed) {
+		int content = board.contents[idx];
+		_system.assign(idx, content == FLAGGED || content == BOMB);
+	}
+
+	int unknown[8];
+	for (int idx : _changed) {
+		int content = board.contents[idx];
+		if(content < 0)
+			continue;
+
+		int row = idx/board.width, col = idx%board.width, count = 0, sum = content;
+		for (int i = row-1; i <= row+1; i++)
+			for (int j = col-1; j <= col+1; j++) {
+				if(i < 0 || i >= board.height || j < 0 || j >= board.width || (i == row && j == col))
+					continue;
+				int n = i*board.width+j, value = _system.known(n);
+				if(value < 0)
+					unknown[count++] = n;
+				else
+					sum -= value;
+			}
+		if(count)
+			_system.add(unknown, count, sum);
+	}
+	for (int idx : _changed)
+		_seen[idx] = board.contents[idx];
+}
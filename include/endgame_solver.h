@@ -0,0 +1,376 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include "def.h"
+#include "solver.h"
+#include "component_cache.h"
+#include "lookahead_solver.h"
+#include "worker_pool.h"
+
+/*
+classes EndgameSearch and EndgameSolver are defined in this file
+
+The safest cell is not always the best guess: near the end of a game, a
+slightly riskier cell may be the one whose number settles the rest of the
+board. When few cells are left unexplored, EndgameSearch lists every layout
+of the remaining bombs consistent with the board (there are at most
+ENDGAME_MAX_LAYOUTS of them, all equally likely) and finds the move with the
+best chance of winning the game, by exhaustive search:
+
+	state --> the set of layouts still possible. Nothing else matters: a
+				cell safe in all of them whose number differs between them
+				is explored first, as it costs nothing, and once none is left
+				the only way forward is a guess. A single layout is a win.
+
+	guess --> exploring a cell that is a bomb in some layouts. The layouts
+				where it is safe split by the number it shows, and the chance
+				of winning is the sum over the splits of their share of the
+				layouts times their own chance.
+
+Sets of layouts are bitsets and the chance of winning from each set reached
+is memoised, as many orders of moves reach the same sets. The candidate
+guesses of the first move are shared between the threads of the
+lookahead's WorkerPool (see worker_pool.h), each with its own memo, so no
+thread is started during a move. The search gives up at a deadline.
+
+EndgameSolver plays like LookaheadSolver, but its guesses come from the
+search when it finishes in time.
+*/
+#define ENDGAME_MAX_CELLS 32
+#define ENDGAME_MAX_LAYOUTS 256
+#define ENDGAME_WORDS (ENDGAME_MAX_LAYOUTS/64)
+#define ENDGAME_BUDGET_MS 50
+#define ENDGAME_CHECK_EVERY 256
+
+class EndgameSearch
+{
+public:
+	bool prepare(const Observation& board);
+	bool solve(WorkerPool& pool, Clock::time_point deadline, Action& action);
+
+	int layouts() const { return (int)_layouts.size(); }
+
+private:
+	struct LayoutSet {
+		uint64_t words[ENDGAME_WORDS];
+
+		bool operator==(const LayoutSet& other) const { return std::equal(words, words+ENDGAME_WORDS, other.words); }
+		bool has(int layout) const { return words[layout >> 6] >> (layout & 63) & 1; }
+		void add(int layout) { words[layout >> 6] |= uint64_t(1) << (layout & 63); }
+		int count() const;
+	};
+	struct LayoutHash {
+		size_t operator()(const LayoutSet& set) const;
+	};
+	typedef std::unordered_map<LayoutSet, double, LayoutHash> Memo;
+
+	//the state of one thread of the search
+	struct Worker {
+		Memo memo;
+		Clock::time_point deadline;
+		long nodes;
+		bool expired;
+	};
+
+	bool list(int cell, int bombs);
+	double win(const LayoutSet& set, Worker& worker) const;
+	double guess(const LayoutSet& set, int cell, Worker& worker) const;
+	int split(const LayoutSet& set, int cell, LayoutSet* parts) const;
+
+	int _width;
+	//the unexplored cells, their unexplored neighbours (bit i for cell i)
+	//and the bombs already known around them
+	std::vector<int> _cells;
+	std::vector<uint32_t> _around;
+	std::vector<int> _flagged;
+	//the numbers next to unexplored cells: their unexplored neighbours and
+	//the bombs they miss among them
+	std::vector<uint32_t> _number_masks;
+	std::vector<int> _number_missing;
+	int _remaining;
+	std::vector<uint32_t> _layouts;
+	uint32_t _chosen;
+};
+
+class EndgameSolver : public LookaheadSolver
+{
+public:
+	explicit EndgameSolver(unsigned seed, int threads = 1, Clock::duration budget = std::chrono::milliseconds(ENDGAME_BUDGET_MS))
+		: LookaheadSolver(seed, threads, budget), _budget(budget) {}
+
+	const char* name() const override { return "endgame"; }
+
+protected:
+	Action guess(const Observation& board) override;
+
+private:
+	EndgameSearch _search;
+	Clock::duration _budget;
+};
+
+inline void registerEndgameSolver() {
+	registerSolver("endgame", [](unsigned seed) { return std::unique_ptr<Solver>(new EndgameSolver(seed)); });
+}
+
+
+/*************************************************************************
+EndgameSearch
+*************************************************************************/
+
+inline int EndgameSearch::LayoutSet::count() const {
+	int count = 0;
+	for (uint64_t word : words)
+		count += __builtin_popcountll(word);
+	return count;
+}
+
+inline size_t EndgameSearch::LayoutHash::operator()(const LayoutSet& set) const {
+	uint64_t hash = 0;
+	for (uint64_t word : set.words)
+		hash = mixBits(hash ^ word);
+	return (size_t)hash;
+}
+
+//lists the layouts of the bombs left over the unexplored cells. Returns
+//false if there are too many cells or too many layouts for the search
+inline bool EndgameSearch::prepare(const Observation& board) {
+	int cells = board.height*board.width;
+	_width = board.width;
+	_cells.clear();
+	_remaining = board.bomb_cnt;
+	for (int idx = 0; idx < cells; idx++) {
+		_remaining -= board.contents[idx] == FLAGGED || board.contents[idx] == BOMB;
+		if(board.contents[idx] == UNEXPLORED)
+			_cells.push_back(idx);
+	}
+	int count = (int)_cells.size();
+	if(count == 0 || count > ENDGAME_MAX_CELLS || _remaining < 0 || _remaining > count)
+		return false;
+
+	//position of every unexplored cell in _cells, through a sorted search
+	auto position = [&](int idx) {
+		auto found = std::lower_bound(_cells.begin(), _cells.end(), idx);
+		return found != _cells.end() && *found == idx ? int(found-_cells.begin()) : -1;
+	};
+	auto forAround = [&](int idx, auto visit) {
+		int row = idx/board.width, col = idx%board.width;
+		for (int i = std::max(row-1, 0); i <= std::min(row+1, board.height-1); i++)
+			for (int j = std::max(col-1, 0); j <= std::min(col+1, board.width-1); j++)
+				if(i != row || j != col)
+					visit(i*board.width+j);
+	};
+
+	_around.assign(count, 0);
+	_flagged.assign(count, 0);
+	for (int i = 0; i < count; i++)
+		forAround(_cells[i], [&](int n) {
+			int content = board.contents[n];
+			_flagged[i] += content == FLAGGED || content == BOMB;
+			if(content == UNEXPLORED)
+				_around[i] |= uint32_t(1) << position(n);
+		});
+
+	_number_masks.clear();
+	_number_missing.clear();
+	for (int idx = 0; idx < cells; idx++) {
+		if(board.contents[idx] < 0)
+			continue;
+		uint32_t mask = 0;
+		int missing = board.contents[idx];
+		forAround(idx, [&](int n) {
+			int content = board.contents[n];
+			missing -= content == FLAGGED || content == BOMB;
+			if(content == UNEXPLORED)
+				mask |= uint32_t(1) << position(n);
+		});
+		if(mask) {
+			_number_masks.push_back(mask);
+			_number_missing.push_back(missing);
+		}
+	}
+
+	_layouts.clear();
+	_chosen = 0;
+	return list(0, 0) && !_layouts.empty();
+}
+
+//tries both values of cell and of the cells after it, bombs bombs placed
+//before it. Returns false once there are too many layouts
+inline bool EndgameSearch::list(int cell, int bombs) {
+	int count = (int)_cells.size();
+	if(bombs > _remaining || bombs+count-cell < _remaining)
+		return true;
+	//a number is checked once all its cells are placed
+	uint32_t placed = cell == 32 ? ~uint32_t(0) : (uint32_t(1) << cell)-1;
+	for (size_t k = 0; k < _number_masks.size(); k++) {
+		uint32_t mask = _number_masks[k];
+		int bombs_in = __builtin_popcount(_chosen & mask);
+		if(bombs_in > _number_missing[k] || ((mask & ~placed) == 0 && bombs_in != _number_missing[k]))
+			return true;
+	}
+	if(cell == count) {
+		if((int)_layouts.size() == ENDGAME_MAX_LAYOUTS)
+			return false;
+		_layouts.push_back(_chosen);
+		return true;
+	}
+
+	if(!list(cell+1, bombs))
+		return false;
+	_chosen |= uint32_t(1) << cell;
+	bool listed = list(cell+1, bombs+1);
+	_chosen &= ~(uint32_t(1) << cell);
+	return listed;
+}
+
+//splits the layouts of set by what exploring cell shows: parts[0] are those
+//where it is a bomb, parts[1+n] those where it shows n. Returns how many of
+//them it is safe in
+inline int EndgameSearch::split(const LayoutSet& set, int cell, LayoutSet* parts) const {
+	std::fill(parts, parts+10, LayoutSet{});
+	int safe = 0;
+	for (int l = 0; l < (int)_layouts.size(); l++) {
+		if(!set.has(l))
+			continue;
+		uint32_t layout = _layouts[l];
+		if(layout >> cell & 1)
+			parts[0].add(l);
+		else {
+			parts[1+_flagged[cell]+__builtin_popcount(layout & _around[cell])].add(l);
+			safe++;
+		}
+	}
+	return safe;
+}
+
+//the chance of winning from set, playing the best moves
+inline double EndgameSearch::win(const LayoutSet& set, Worker& worker) const {
+	int total = set.count();
+	if(total <= 1)
+		return total;
+	if(++worker.nodes%ENDGAME_CHECK_EVERY == 0 && Clock::now() > worker.deadline)
+		worker.expired = true;
+	if(worker.expired)
+		return 0;
+
+	auto memo = worker.memo.find(set);
+	if(memo != worker.memo.end())
+		return memo->second;
+
+	//a cell safe everywhere that tells layouts apart is explored for free
+	LayoutSet parts[10];
+	int count = (int)_cells.size();
+	double best = -1;
+	for (int cell = 0; cell < count && best < 0; cell++) {
+		if(split(set, cell, parts) != total)
+			continue;
+		int shown = 0;
+		for (int n = 1; n < 10; n++)
+			shown += parts[n].count() > 0;
+		if(shown < 2)
+			continue;
+		best = 0;
+		for (int n = 1; n < 10; n++) {
+			int size = parts[n].count();
+			if(size)
+				best += size*win(parts[n], worker)/total;
+		}
+	}
+
+	if(best < 0)
+		for (int cell = 0; cell < count; cell++)
+			best = std::max(best, guess(set, cell, worker));
+
+	worker.memo.emplace(set, best);
+	return best;
+}
+
+//the chance of winning from set by exploring cell first, a guess. 0 if it
+//is a bomb in every layout or safe in all of them (that tells nothing)
+inline double EndgameSearch::guess(const LayoutSet& set, int cell, Worker& worker) const {
+	LayoutSet parts[10];
+	int total = set.count(), safe = split(set, cell, parts);
+	if(safe == 0 || safe == total)
+		return 0;
+	double chance = 0;
+	for (int n = 1; n < 10; n++) {
+		int size = parts[n].count();
+		if(size)
+			chance += size*win(parts[n], worker)/total;
+	}
+	return chance;
+}
+
+//finds the move with the best chance of winning, spreading the guesses
+//to evaluate over the threads of pool. Returns false if the search did not
+//end by deadline
+inline bool EndgameSearch::solve(WorkerPool& pool, Clock::time_point deadline, Action& action) {
+	int count = (int)_cells.size(), total = (int)_layouts.size();
+	LayoutSet all = {};
+	for (int l = 0; l < total; l++)
+		all.add(l);
+
+	//a safe cell: the one that tells layouts apart if any, or any when
+	//there is a single layout left
+	LayoutSet parts[10];
+	for (int cell = 0; cell < count; cell++) {
+		if(split(all, cell, parts) != total)
+			continue;
+		int shown = 0;
+		for (int n = 1; n < 10; n++)
+			shown += parts[n].count() > 0;
+		if(shown > 1 || total == 1) {
+			action = {_cells[cell]/_width, _cells[cell]%_width, LEFT};
+			return true;
+		}
+	}
+
+	std::vector<double> chances(count, -1);
+	std::vector<int> safe(count, 0);
+	for (int cell = 0; cell < count; cell++)
+		safe[cell] = split(all, cell, parts);
+	std::atomic<int> next(0);
+	std::atomic<bool> expired(false);
+	pool.run(pool.size(), [&](int) {
+		Worker worker = {Memo(), deadline, 0, false};
+		for (int cell = next++; cell < count && !expired; cell = next++) {
+			if(safe[cell] == 0 || safe[cell] == total)
+				continue;
+			chances[cell] = guess(all, cell, worker);
+			if(worker.expired)
+				expired = true;
+		}
+	});
+	if(expired)
+		return false;
+
+	//the best chance of winning, then the safest
+	int best = -1;
+	for (int cell = 0; cell < count; cell++)
+		if(chances[cell] >= 0 && (best < 0 || chances[cell] > chances[best]+1e-12
+				|| (chances[cell] > chances[best]-1e-12 && safe[cell] > safe[best])))
+			best = cell;
+	if(best < 0)
+		return false;
+	action = {_cells[best]/_width, _cells[best]%_width, LEFT};
+	return true;
+}
+
+
+/*************************************************************************
+EndgameSolver
+*************************************************************************/
+
+//the lookahead only gets what the endgame search left of the budget, so a
+//move never takes much more than the budget
+inline Action EndgameSolver::guess(const Observation& board) {
+	Clock::time_point deadline = Clock::now()+_budget;
+	Action action;
+	if(_search.prepare(board) && _search.solve(pool(), deadline, action))
+		return action;
+	return LookaheadSolver::guess(board, deadline);
+}
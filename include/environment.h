@@ -0,0 +1,121 @@
+#pragma once
+
+#include <cstdint>
+#include <random>
+#include <vector>
+#include "def.h"
+#include "board_state.h"
+#include "observation.h"
+
+//rewards handed out by VectorEnv::step. Every explored safe cell is also worth
+//1/(number of safe cells), so a game played to the end scores 1+REWARD_WIN
+#define REWARD_WIN 1.0f
+#define REWARD_LOSS -1.0f
+
+/*
+class VectorEnv is defined in this file
+
+VectorEnv<H, W> steps count independent games at once, for reinforcement
+learning. There is no window and no thread: step() applies one action to
+every board and writes what the agent gets back into buffers owned by the
+caller, so a training loop can reuse the same arrays for every step and
+nothing is allocated once the environment is built.
+
+	observations --> count planes of height*width bytes, one per board, row
+				by row. Each byte is what the player can see of the cell:
+				the number of bombs around it (0 to 8) once explored,
+				UNEXPLORED, FLAGGED or BOMB (the one that lost the game)
+				otherwise. See observationSize().
+
+	rewards --> count floats. The share of the safe cells the action
+				explored, plus REWARD_WIN when it wins the game or
+				REWARD_LOSS alone when it loses it.
+
+	dones --> count bytes, 1 where the action ended the game.
+
+observations may be nullptr, for callers that want another format: they
+can export board(i).view() themselves with the functions of observation.h.
+
+A finished board is started again right away, so the observation returned
+with done = 1 is already the first one of the next game. Every game comes
+from a seed drawn from the seed given to the constructor, so a run can be
+reproduced exactly.
+*/
+template <int H = 0, int W = 0>
+class VectorEnv
+{
+public:
+	VectorEnv(int count, int height, int width, int bomb_cnt, unsigned seed);
+	VectorEnv(int count, int bomb_cnt, unsigned seed);
+
+	int size() const { return (int)_boards.size(); }
+	int observationSize() const { return _grid.size(); }
+	const BoardState<H, W>& board(int i) const { return _boards[i]; }
+
+	void reset(int8_t* observations);
+	void step(const Action* actions, int8_t* observations, float* rewards, uint8_t* dones);
+
+private:
+	void observe(int i, int8_t* observation) const;
+
+	Grid<H, W> _grid;
+	std::vector<BoardState<H, W>> _boards;
+	std::minstd_rand _seeds;
+	float _reward_per_cell;
+};
+
+
+template <int H, int W>
+VectorEnv<H, W>::VectorEnv(int count, int height, int width, int bomb_cnt, unsigned seed) : _grid(height, width),
+																					_seeds(seed),
+																					_reward_per_cell(1.0f/(height*width-bomb_cnt)) {
+	_boards.reserve(count);
+	for (int i = 0; i < count; i++)
+		_boards.emplace_back(height, width, bomb_cnt, _seeds());
+}
+
+//fixed size boards only
+template <int H, int W>
+VectorEnv<H, W>::VectorEnv(int count, int bomb_cnt, unsigned seed) : VectorEnv(count, H, W, bomb_cnt, seed) {
+	static_assert(H > 0 && W > 0, "VectorEnv<>(count, bomb_cnt, seed) needs the dimensions, use VectorEnv<>(count, height, width, bomb_cnt, seed)");
+}
+
+//starts a new game on every board and writes their first observations
+template <int H, int W>
+void VectorEnv<H, W>::reset(int8_t* observations) {
+	for (int i = 0; i < size(); i++) {
+		_boards[i].reset(_seeds());
+		if(observations)
+			observe(i, observations+i*observationSize());
+	}
+}
+
+//applies actions[i] to board i, for every board. Actions outside the board
+//change nothing and earn nothing
+template <int H, int W>
+void VectorEnv<H, W>::step(const Action* actions, int8_t* observations, float* rewards, uint8_t* dones) {
+	PROFILE_SCOPE("VectorEnv::step");
+	for (int i = 0; i < size(); i++) {
+		BoardState<H, W>& board = _boards[i];
+		int revealed = board.revealed();
+		board.apply(actions[i]);
+
+		rewards[i] = (board.revealed()-revealed)*_reward_per_cell;
+		dones[i] = board.endOfGame();
+		if(board.lost())
+			rewards[i] = REWARD_LOSS;
+		else if(board.won())
+			rewards[i] += REWARD_WIN;
+
+		if(dones[i])
+			board.reset(_seeds());
+		if(observations)
+			observe(i, observations+i*observationSize());
+	}
+}
+
+//copies what the player sees of board i, row by row, without the sentinels
+template <int H, int W>
+void VectorEnv<H, W>::observe(int i, int8_t* observation) const {
+	exportContents(_boards[i].view(), observation, _grid.width());
+}
@@ -0,0 +1,177 @@
+#pragma once
+
+#include <vector>
+#include "def.h"
+#include "grid.h"
+
+/*
+classes IndexedSet and Frontier are defined in this file
+
+Solvers, hints and probabilities all start from the same two sets of cells:
+
+	frontier --> the unexplored cells next to at least one explored cell.
+				Everything a solver can deduce is about these cells; the
+				rest of the unexplored cells are all alike.
+
+	constraints --> the explored cells with at least one unexplored
+				neighbour. Each of them is a constraint on the frontier:
+				its number minus its flagged neighbours is how many of its
+				unexplored neighbours are bombs.
+
+Frontier keeps both up to date as the board changes instead of rescanning
+it. For every cell it counts the explored and the unexplored cells around
+it, so a change of visibility only has to adjust the counts of the 8
+neighbours and re-check those 9 cells, whatever the size of the board.
+Flagged cells are in neither set.
+
+IndexedSet is the set behind them: a dense array of members, cheap to
+iterate, plus the position of every cell in that array, so insertions and
+removals are O(1). Members are indices in the padded storage (see grid.h),
+in no particular order.
+*/
+class IndexedSet
+{
+public:
+	void reset(int capacity);
+	bool contains(int idx) const { return _positions[idx] >= 0; }
+	void insert(int idx);
+	void erase(int idx);
+	void set(int idx, bool member);
+
+	int size() const { return (int)_members.size(); }
+	bool empty() const { return _members.empty(); }
+	const int* begin() const { return _members.data(); }
+	const int* end() const { return _members.data()+_members.size(); }
+	int operator[](int i) const { return _members[i]; }
+
+private:
+	std::vector<int> _members;
+	std::vector<int> _positions;
+};
+
+template <int H = 0, int W = 0>
+class Frontier
+{
+public:
+	void build(const Grid<H, W>& grid, const Visibility* visibility);
+	void clear();
+	bool active() const { return !_around.empty(); }
+	void changed(const Grid<H, W>& grid, const Visibility* visibility, int idx, Visibility before);
+
+	const IndexedSet& cells() const { return _cells; }
+	const IndexedSet& constraints() const { return _constraints; }
+
+private:
+	void update(const Visibility* visibility, int idx);
+
+	//for every cell, the explored (FREE) and UNEXPLORED cells around it and
+	//the sets it is in, kept together so an update reads a single place
+	enum Member : uint8_t {IN_FRONTIER=1, IN_CONSTRAINTS=2};
+	struct Around {
+		int8_t free, unexplored;
+		uint8_t member;
+	};
+
+	std::vector<Around> _around;
+	IndexedSet _cells;
+	IndexedSet _constraints;
+};
+
+
+/*************************************************************************
+IndexedSet
+*************************************************************************/
+
+//empties the set, for indices in [0, capacity)
+inline void IndexedSet::reset(int capacity) {
+	_members.clear();
+	_members.reserve(capacity);
+	_positions.assign(capacity, -1);
+}
+
+inline void IndexedSet::insert(int idx) {
+	if(_positions[idx] >= 0)
+		return;
+	_positions[idx] = (int)_members.size();
+	_members.push_back(idx);
+}
+
+//the last member takes the place of the removed one
+inline void IndexedSet::erase(int idx) {
+	int position = _positions[idx];
+	if(position < 0)
+		return;
+	int last = _members.back();
+	_members[position] = last;
+	_positions[last] = position;
+	_members.pop_back();
+	_positions[idx] = -1;
+}
+
+inline void IndexedSet::set(int idx, bool member) {
+	if(member)
+		insert(idx);
+	else
+		erase(idx);
+}
+
+
+/*************************************************************************
+Frontier
+*************************************************************************/
+
+//starts tracking a board from its current visibility, in O(board)
+template <int H, int W>
+void Frontier<H, W>::build(const Grid<H, W>& grid, const Visibility* visibility) {
+	_around.assign(grid.storageSize(), Around{0, 0, 0});
+	_cells.reset(grid.storageSize());
+	_constraints.reset(grid.storageSize());
+
+	grid.forEachCell([&](int idx) {
+		grid.forEachNeighbour(idx, [&](int n) {
+			_around[n].free += visibility[idx] == FREE;
+			_around[n].unexplored += visibility[idx] == UNEXPLORED;
+		});
+	});
+	grid.forEachCell([&](int idx) { update(visibility, idx); });
+}
+
+//stops tracking and frees the memory
+template <int H, int W>
+void Frontier<H, W>::clear() {
+	std::vector<Around>().swap(_around);
+	_cells = IndexedSet();
+	_constraints = IndexedSet();
+}
+
+//must be called after every change of visibility of the cell idx, which was
+//before until then
+template <int H, int W>
+void Frontier<H, W>::changed(const Grid<H, W>& grid, const Visibility* visibility, int idx, Visibility before) {
+	Visibility after = visibility[idx];
+	int free = (after == FREE)-(before == FREE);
+	int unexplored = (after == UNEXPLORED)-(before == UNEXPLORED);
+
+	grid.forEachNeighbour(idx, [&](int n) {
+		_around[n].free += free;
+		_around[n].unexplored += unexplored;
+		update(visibility, n);
+	});
+	update(visibility, idx);
+}
+
+template <int H, int W>
+void Frontier<H, W>::update(const Visibility* visibility, int idx) {
+	Around& around = _around[idx];
+	int member = ((visibility[idx] == UNEXPLORED) & (around.free > 0))*IN_FRONTIER
+				| ((visibility[idx] == FREE) & (around.unexplored > 0))*IN_CONSTRAINTS;
+	//most calls change nothing, so only this test has to be predicted well
+	if(member == around.member)
+		return;
+
+	if((member ^ around.member) & IN_FRONTIER)
+		_cells.set(idx, member & IN_FRONTIER);
+	if((member ^ around.member) & IN_CONSTRAINTS)
+		_constraints.set(idx, member & IN_CONSTRAINTS);
+	around.member = member;
+}
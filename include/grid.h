@@ -0,0 +1,159 @@
+#pragma once
+
+#include <array>
+#include <cassert>
+#include <cstdint>
+#include <vector>
+#include "def.h"
+#include "cell.h"
+
+/*
+class Grid is defined in this file
+
+Grid<H, W> describes the shape of a board with H rows and W columns: how a
+(row, col) pair maps to an index in the flat cell storage, what that storage
+is, and which cells are neighbours of which.
+
+The storage is padded with a ring of inert sentinel cells one cell wide, so
+it holds (H+2) x (W+2) cells and row r, column c lives at index
+(r+1)*stride + c+1 with stride = W+2. Every playable cell therefore has all 8
+neighbours in memory, at the same 8 offsets from its own index, and neighbour
+loops need no row or column tests at all: they visit the sentinels and the
+sentinels just never match anything (they are not UNEXPLORED, not FLAGGED
+and never hold a bomb).
+
+	Grid<H, W> --> dimensions are compile-time constants. Cells live in a
+				std::array and the offsets are constants, so neighbour loops
+				are fully unrolled.
+
+	Grid<> --> dimensions are chosen at run time. Cells live in a std::vector
+				and the offsets are computed once from the stride.
+
+Both expose the same interface, so Board and Cell::initBoard are written once
+and the compiler picks the cheapest version for each board size.
+*/
+template <int H = 0, int W = 0>
+class Grid
+{
+	static_assert(H > 0 && W > 0, "fixed size boards need positive dimensions");
+
+public:
+	static constexpr int STRIDE = W+2;
+
+	template <typename T> using Array = std::array<T, (H+2)*(W+2)>;
+
+	constexpr Grid() {}
+	Grid(int height, int width) { assert(height == H && width == W); }
+
+	constexpr int height() const { return H; }
+	constexpr int width() const { return W; }
+	constexpr int size() const { return H*W; }
+	constexpr int stride() const { return STRIDE; }
+	constexpr int storageSize() const { return (H+2)*(W+2); }
+	constexpr int index(int row, int col) const { return (row+1)*STRIDE+col+1; }
+	constexpr int row(int idx) const { return idx/STRIDE-1; }
+	constexpr int col(int idx) const { return idx%STRIDE-1; }
+
+	template <typename T> void allocate(Array<T>& cells, const T& cell, const T& border) const;
+
+	template <typename F> void forEachNeighbour(int idx, F f) const;
+	template <typename F> void forEachCell(F f) const;
+
+	static constexpr int OFFSETS[8] = {-STRIDE-1, -STRIDE, -STRIDE+1, -1, 1, STRIDE-1, STRIDE, STRIDE+1};
+};
+
+template <>
+class Grid<0, 0>
+{
+public:
+	template <typename T> using Array = std::vector<T>;
+
+	Grid(int height, int width);
+
+	int height() const { return _height; }
+	int width() const { return _width; }
+	int size() const { return _height*_width; }
+	int stride() const { return _width+2; }
+	int storageSize() const { return (_height+2)*(_width+2); }
+	int index(int row, int col) const { return (row+1)*(_width+2)+col+1; }
+	int row(int idx) const { return idx/(_width+2)-1; }
+	int col(int idx) const { return idx%(_width+2)-1; }
+
+	template <typename T> void allocate(Array<T>& cells, const T& cell, const T& border) const;
+
+	template <typename F> void forEachNeighbour(int idx, F f) const;
+	template <typename F> void forEachCell(F f) const;
+
+	int OFFSETS[8];
+
+private:
+	int _height, _width;
+};
+
+//read-only view of a board's padded storage, whatever its Grid. This is what
+//the renderer draws. The cells of layout hold the contents and visibility the
+//visibility of each of them (see board_state.h)
+struct BoardView {
+	const Cell* layout;
+	const Visibility* visibility;
+	int height, width, stride;
+
+	Cell at(int row, int col) const {
+		int idx = (row+1)*stride+col+1;
+		Cell cell = layout[idx];
+		cell.setVisibility(visibility[idx]);
+		return cell;
+	}
+};
+
+
+inline Grid<0, 0>::Grid(int height, int width) : _height(height), _width(width) {
+	int s = _width+2;
+	int offsets[8] = {-s-1, -s, -s+1, -1, 1, s-1, s, s+1};
+	for (int k = 0; k < 8; k++)
+		OFFSETS[k] = offsets[k];
+}
+
+//fills the playable cells with cell and the sentinel ring with border
+template <int H, int W>
+template <typename T>
+void Grid<H, W>::allocate(Array<T>& cells, const T& cell, const T& border) const {
+	cells.fill(border);
+	forEachCell([&](int idx) { cells[idx] = cell; });
+}
+
+template <typename T>
+void Grid<0, 0>::allocate(Array<T>& cells, const T& cell, const T& border) const {
+	cells.assign(storageSize(), border);
+	forEachCell([&](int idx) { cells[idx] = cell; });
+}
+
+//calls f(neighbour index) for the 8 cells around idx, sentinels included
+template <int H, int W>
+template <typename F>
+void Grid<H, W>::forEachNeighbour(int idx, F f) const {
+	for (int k = 0; k < 8; k++)
+		f(idx+OFFSETS[k]);
+}
+
+template <typename F>
+void Grid<0, 0>::forEachNeighbour(int idx, F f) const {
+	for (int k = 0; k < 8; k++)
+		f(idx+OFFSETS[k]);
+}
+
+//calls f(index) for every playable cell, row by row
+template <int H, int W>
+template <typename F>
+void Grid<H, W>::forEachCell(F f) const {
+	for (int row = 0; row < H; row++)
+		for (int idx = index(row, 0); idx < index(row, 0)+W; idx++)
+			f(idx);
+}
+
+template <typename F>
+void Grid<0, 0>::forEachCell(F f) const {
+	for (int row = 0; row < _height; row++)
+		for (int idx = index(row, 0); idx < index(row, 0)+_width; idx++)
+			f(idx);
+}
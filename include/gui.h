@@ -4,17 +4,30 @@
 #include <cmath>
 #include "def.h"
 #include "cell.h"
+#include "grid.h"
+#include "latency.h"
+#include "profiler.h"
+#include "vertex_batch.h"
 
 class Gui
 {
 public:
 	Gui();
+	Gui(int, int);
 	Gui(int, int, bool);
 	~Gui();
-	void drawBoard(const std::vector<std::vector<Cell>>& c);
+	void drawBoard(const BoardView& c);
+	const VertexBatch& buildBoard(const BoardView& c);
+	void drawLatencyOverlay(const LatencyTracker& latency);
+	void drawProfilerOverlay(const Profiler& profiler);
+	void swapBuffers();
+	void pollEvents();
 
 	void mouseButtonCallback(GLFWwindow* window, int button, int action, int mods);
-	bool getLastMousePress(int& x, int& y, MouseButton &button);
+	void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods);
+	bool getLastMousePress(Move& move);
+	bool showLatency() const;
+	bool showProfiler() const;
 
 public:
 	GLFWwindow* _window;
@@ -37,7 +50,12 @@ private:
 	int _height, _width;
 	int _last_pressed_x, _last_pressed_y;
 	MouseButton _mouse_button;
+	Clock::time_point _last_pressed_time;
 	bool _pressed;
+	bool _show_latency;
+	bool _show_profiler;
+
+	VertexBatch _batch;
 };
 
 
@@ -50,8 +68,17 @@ static void mouseButtonCallback_static(GLFWwindow* window, int button, int actio
 	gui->mouseButtonCallback(window, button, action, mods);
 }
 
+static void keyCallback_static(GLFWwindow* window, int key, int scancode, int action, int mods) {
+	Gui* gui = (Gui*)glfwGetWindowUserPointer(window);
+	gui->keyCallback(window, key, scancode, action, mods);
+}
+
 void Gui::mouseButtonCallback(GLFWwindow* window, int button, int action, int mods) {
 	double xpos, ypos;
+	//first latency timestamp, see latency.h. Only a press sets it: a release
+	//polled with its press must not make the move look faster
+	if(action == GLFW_PRESS)
+		_last_pressed_time = Clock::now();
 	if(button == GLFW_MOUSE_BUTTON_LEFT && action == GLFW_PRESS) {
 		glfwGetCursorPos(window, &xpos, &ypos);
 		_last_pressed_x = (int)xpos/SQUARE_SIZE;
@@ -66,22 +93,67 @@ void Gui::mouseButtonCallback(GLFWwindow* window, int button, int action, int mo
 		_mouse_button = RIGHT;
 		_pressed = true;
 	}
+	else if(button == GLFW_MOUSE_BUTTON_MIDDLE && action == GLFW_PRESS) {
+		glfwGetCursorPos(window, &xpos, &ypos);
+		_last_pressed_x = (int)xpos/SQUARE_SIZE;
+		_last_pressed_y = _height-(int)ypos/SQUARE_SIZE-1;
+		_mouse_button = MIDDLE;
+		_pressed = true;
+	}
+
+	//pressing the second of left and right while the other is held is a
+	//chord too. The first press has already been sent on its own, which is
+	//harmless on the revealed number being chorded
+	if(action == GLFW_PRESS &&
+			glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_LEFT) == GLFW_PRESS &&
+			glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_RIGHT) == GLFW_PRESS)
+		_mouse_button = MIDDLE;
 }
 
-bool Gui::getLastMousePress(int& x, int& y, MouseButton &button) {
+//L toggles the latency overlay, P the frame-time graph. Ctrl+Z and Ctrl+Y
+//(or Ctrl+Shift+Z) are sent like clicks, as UNDO and REDO
+void Gui::keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods) {
+	if((action == GLFW_PRESS || action == GLFW_REPEAT) && (mods & GLFW_MOD_CONTROL)) {
+		if(key == GLFW_KEY_Z || key == GLFW_KEY_Y) {
+			_last_pressed_x = _last_pressed_y = 0;
+			_last_pressed_time = Clock::now();
+			_mouse_button = key == GLFW_KEY_Y || (mods & GLFW_MOD_SHIFT) ? REDO : UNDO;
+			_pressed = true;
+		}
+	}
+
+	if(key == GLFW_KEY_L && action == GLFW_PRESS)
+		_show_latency = !_show_latency;
+	if(key == GLFW_KEY_P && action == GLFW_PRESS)
+		_show_profiler = !_show_profiler;
+}
+
+bool Gui::getLastMousePress(Move& move) {
 	if(_pressed) {
-		x = _last_pressed_x; y = _last_pressed_y; button = _mouse_button;
+		move.col = _last_pressed_x; move.row = _last_pressed_y; move.button = _mouse_button;
+		move.pressed = _last_pressed_time;
 		_pressed = false;
 		return true;
 	}
 	return false;
 }
 
+bool Gui::showLatency() const {
+	return _show_latency;
+}
+
+bool Gui::showProfiler() const {
+	return _show_profiler;
+}
+
 Gui::Gui() {
 	_window = nullptr;
 }
 
-Gui::Gui(int height, int width, bool interaction) : _height(height), _width(width), _pressed(false) {
+//offscreen Gui: no window and no GL context, only buildBoard can be used
+Gui::Gui(int height, int width) : _window(nullptr), _height(height), _width(width), _mouse_button(LEFT), _pressed(false), _show_latency(false), _show_profiler(false) {}
+
+Gui::Gui(int height, int width, bool interaction) : _height(height), _width(width), _mouse_button(LEFT), _pressed(false), _show_latency(false), _show_profiler(false) {
 	glfwSetErrorCallback(error_callback);
 	if (!glfwInit())
 		exit(EXIT_FAILURE);
@@ -95,9 +167,13 @@ Gui::Gui(int height, int width, bool interaction) : _height(height), _width(widt
 	}
 
 	glfwMakeContextCurrent(_window);
+	//rendering runs on its own thread now, so pace it with the display
+	glfwSwapInterval(1);
 
-	if(interaction)
+	if(interaction) {
 		glfwSetMouseButtonCallback(_window, mouseButtonCallback_static);
+		glfwSetKeyCallback(_window, keyCallback_static);
+	}
 }
 
 float Gui::getXAxis(float col, float position) {
@@ -120,45 +196,45 @@ void Gui::drawUnpressedSquare(int row, int col) {
 	float in_x_low = 2.0*(col+0+SHADE)/_width-1;
 	float in_x_high = 2.0*(col+1-SHADE)/_width-1;
 
-	glBegin(GL_QUADS);
-		glColor3f(0.65f, 0.65f, 0.65f);
-		glVertex2f(in_x_low, in_y_high);
-		glVertex2f(in_x_low, in_y_low);
-		glVertex2f(in_x_high, in_y_low);
-		glVertex2f(in_x_high, in_y_high);
-	glEnd();
-
-	glBegin(GL_QUADS);
-		glColor3f(0.55f, 0.55f, 0.55f);
-		glVertex2f(in_x_high, in_y_high);
-		glVertex2f(in_x_high, in_y_low);
-		glVertex2f(out_x_high, out_y_low);
-		glVertex2f(out_x_high, out_y_high);
-	glEnd();
-
-	glBegin(GL_QUADS);
-		glColor3f(0.55f, 0.55f, 0.55f);
-		glVertex2f(in_x_high, in_y_low);
-		glVertex2f(in_x_low, in_y_low);
-		glVertex2f(out_x_low, out_y_low);
-		glVertex2f(out_x_high, out_y_low);
-	glEnd();
-
-	glBegin(GL_QUADS);
-		glColor3f(0.75f, 0.75f, 0.75f);
-		glVertex2f(in_x_low, in_y_low);
-		glVertex2f(in_x_low, in_y_high);
-		glVertex2f(out_x_low, out_y_high);
-		glVertex2f(out_x_low, out_y_low);
-	glEnd();
-
-	glBegin(GL_QUADS);
-		glColor3f(0.75f, 0.75f, 0.75f);
-		glVertex2f(in_x_low, in_y_high);
-		glVertex2f(in_x_high, in_y_high);
-		glVertex2f(out_x_high, out_y_high);
-		glVertex2f(out_x_low, out_y_high);
-	glEnd();
+	_batch.begin(GL_QUADS);
+		_batch.color(0.65f, 0.65f, 0.65f);
+		_batch.vertex(in_x_low, in_y_high);
+		_batch.vertex(in_x_low, in_y_low);
+		_batch.vertex(in_x_high, in_y_low);
+		_batch.vertex(in_x_high, in_y_high);
+	_batch.end();
+
+	_batch.begin(GL_QUADS);
+		_batch.color(0.55f, 0.55f, 0.55f);
+		_batch.vertex(in_x_high, in_y_high);
+		_batch.vertex(in_x_high, in_y_low);
+		_batch.vertex(out_x_high, out_y_low);
+		_batch.vertex(out_x_high, out_y_high);
+	_batch.end();
+
+	_batch.begin(GL_QUADS);
+		_batch.color(0.55f, 0.55f, 0.55f);
+		_batch.vertex(in_x_high, in_y_low);
+		_batch.vertex(in_x_low, in_y_low);
+		_batch.vertex(out_x_low, out_y_low);
+		_batch.vertex(out_x_high, out_y_low);
+	_batch.end();
+
+	_batch.begin(GL_QUADS);
+		_batch.color(0.75f, 0.75f, 0.75f);
+		_batch.vertex(in_x_low, in_y_low);
+		_batch.vertex(in_x_low, in_y_high);
+		_batch.vertex(out_x_low, out_y_high);
+		_batch.vertex(out_x_low, out_y_low);
+	_batch.end();
+
+	_batch.begin(GL_QUADS);
+		_batch.color(0.75f, 0.75f, 0.75f);
+		_batch.vertex(in_x_low, in_y_high);
+		_batch.vertex(in_x_high, in_y_high);
+		_batch.vertex(out_x_high, out_y_high);
+		_batch.vertex(out_x_low, out_y_high);
+	_batch.end();
 }
 
 void Gui::drawPressedSquare(int row, int col) {
@@ -167,38 +243,38 @@ void Gui::drawPressedSquare(int row, int col) {
 	float y_low = getYAxis(row, 0);
 	float y_high = getYAxis(row, 1);
 
-	glBegin(GL_QUADS);
-		glColor3f(0.65f, 0.65f, 0.65f);
-		glVertex2f(x_low, y_high);
-		glVertex2f(x_low, y_low);
-		glVertex2f(x_high, y_low);
-		glVertex2f(x_high, y_high);
-	glEnd();
-
-
-	glBegin(GL_LINES);
-		glColor3f(0.6f, 0.6f, 0.6f);
-		glVertex2f(x_low, y_low);
-		glVertex2f(x_low, y_high);
-	glEnd();
-
-	glBegin(GL_LINES);
-		glColor3f(0.6f, 0.6f, 0.6f);
-		glVertex2f(x_low, y_high);
-		glVertex2f(x_high, y_high);
-	glEnd();
-
-	glBegin(GL_LINES);
-		glColor3f(0.6f, 0.6f, 0.6f);
-		glVertex2f(x_high, y_high);
-		glVertex2f(x_high, y_low);
-	glEnd();
-
-	glBegin(GL_LINES);
-		glColor3f(0.6f, 0.6f, 0.6f);
-		glVertex2f(x_high, y_low);
-		glVertex2f(x_low, y_low);
-	glEnd();
+	_batch.begin(GL_QUADS);
+		_batch.color(0.65f, 0.65f, 0.65f);
+		_batch.vertex(x_low, y_high);
+		_batch.vertex(x_low, y_low);
+		_batch.vertex(x_high, y_low);
+		_batch.vertex(x_high, y_high);
+	_batch.end();
+
+
+	_batch.begin(GL_LINES);
+		_batch.color(0.6f, 0.6f, 0.6f);
+		_batch.vertex(x_low, y_low);
+		_batch.vertex(x_low, y_high);
+	_batch.end();
+
+	_batch.begin(GL_LINES);
+		_batch.color(0.6f, 0.6f, 0.6f);
+		_batch.vertex(x_low, y_high);
+		_batch.vertex(x_high, y_high);
+	_batch.end();
+
+	_batch.begin(GL_LINES);
+		_batch.color(0.6f, 0.6f, 0.6f);
+		_batch.vertex(x_high, y_high);
+		_batch.vertex(x_high, y_low);
+	_batch.end();
+
+	_batch.begin(GL_LINES);
+		_batch.color(0.6f, 0.6f, 0.6f);
+		_batch.vertex(x_high, y_low);
+		_batch.vertex(x_low, y_low);
+	_batch.end();
 }
 
 void Gui::drawFlag(int row, int col) {
@@ -208,73 +284,73 @@ void Gui::drawFlag(int row, int col) {
 	float x_low = getXAxis(col, 0.5);
 	float x_high = getXAxis(col, 0.5+FLAG);
 
-	glBegin(GL_QUADS);
-		glColor3f(1, 0, 0);
-		glVertex2f(x_low, y_high);
-		glVertex2f(x_low, y_low);
-		glVertex2f(x_high, y_low);
-		glVertex2f(x_high, y_high);
-	glEnd();
+	_batch.begin(GL_QUADS);
+		_batch.color(1, 0, 0);
+		_batch.vertex(x_low, y_high);
+		_batch.vertex(x_low, y_low);
+		_batch.vertex(x_high, y_low);
+		_batch.vertex(x_high, y_high);
+	_batch.end();
 
 	float p1_x, p1_y, p2_x, p2_y, p3_x, p3_y;
 	p1_x = x_low; p1_y = y_high;
 	p3_x = x_low; p3_y = getYAxis(row, 1-FLAG_Y - (1-2*FLAG_Y)/2);
 	p2_x = getXAxis(col, 0.5-3*FLAG); p2_y = (p1_y+p3_y)/2;
 
-	glBegin(GL_TRIANGLES);
-		glColor3f(1, 0, 0);
-		glVertex2f(p1_x, p1_y);
-		glVertex2f(p2_x, p2_y);
-		glVertex2f(p3_x, p3_y);
-	glEnd();
-
-	glBegin(GL_QUADS);
-		glColor3f(0, 0, 0);
-
-		glVertex2f(getXAxis(col, 0.5+2*FLAG), y_low);
-		glVertex2f(getXAxis(col, 0.5-2*FLAG), y_low);
-		glVertex2f(getXAxis(col, 0.5-2*FLAG), y_low-0.01);
-		glVertex2f(getXAxis(col, 0.5+2*FLAG), y_low-0.01);
-	glEnd();
+	_batch.begin(GL_TRIANGLES);
+		_batch.color(1, 0, 0);
+		_batch.vertex(p1_x, p1_y);
+		_batch.vertex(p2_x, p2_y);
+		_batch.vertex(p3_x, p3_y);
+	_batch.end();
+
+	_batch.begin(GL_QUADS);
+		_batch.color(0, 0, 0);
+
+		_batch.vertex(getXAxis(col, 0.5+2*FLAG), y_low);
+		_batch.vertex(getXAxis(col, 0.5-2*FLAG), y_low);
+		_batch.vertex(getXAxis(col, 0.5-2*FLAG), y_low-0.01);
+		_batch.vertex(getXAxis(col, 0.5+2*FLAG), y_low-0.01);
+	_batch.end();
 }
 
 void Gui::drawBomb(int row, int col) {
 
-	glBegin(GL_QUADS);
-		glColor3f(0.2f, 0.2f, 0.2f);
+	_batch.begin(GL_QUADS);
+		_batch.color(0.2f, 0.2f, 0.2f);
 
-		glVertex2f(getXAxis(col, 0.35), getYAxis(row, 0.35));
-		glVertex2f(getXAxis(col, 0.35), getYAxis(row, 0.65));
-		glVertex2f(getXAxis(col, 0.65), getYAxis(row, 0.65));
-		glVertex2f(getXAxis(col, 0.65), getYAxis(row, 0.35));
-	glEnd();
+		_batch.vertex(getXAxis(col, 0.35), getYAxis(row, 0.35));
+		_batch.vertex(getXAxis(col, 0.35), getYAxis(row, 0.65));
+		_batch.vertex(getXAxis(col, 0.65), getYAxis(row, 0.65));
+		_batch.vertex(getXAxis(col, 0.65), getYAxis(row, 0.35));
+	_batch.end();
 
-	glBegin(GL_QUADS);
-		glColor3f(0.2f, 0.2f, 0.2f);
+	_batch.begin(GL_QUADS);
+		_batch.color(0.2f, 0.2f, 0.2f);
 
-		glVertex2f(getXAxis(col, 0.45), getYAxis(row, 0.25));
-		glVertex2f(getXAxis(col, 0.45), getYAxis(row, 0.75));
-		glVertex2f(getXAxis(col, 0.55), getYAxis(row, 0.75));
-		glVertex2f(getXAxis(col, 0.55), getYAxis(row, 0.25));
-	glEnd();
+		_batch.vertex(getXAxis(col, 0.45), getYAxis(row, 0.25));
+		_batch.vertex(getXAxis(col, 0.45), getYAxis(row, 0.75));
+		_batch.vertex(getXAxis(col, 0.55), getYAxis(row, 0.75));
+		_batch.vertex(getXAxis(col, 0.55), getYAxis(row, 0.25));
+	_batch.end();
 
-	glBegin(GL_QUADS);
-		glColor3f(0.2f, 0.2f, 0.2f);
+	_batch.begin(GL_QUADS);
+		_batch.color(0.2f, 0.2f, 0.2f);
 
-		glVertex2f(getXAxis(col, 0.25), getYAxis(row, 0.45));
-		glVertex2f(getXAxis(col, 0.75), getYAxis(row, 0.45));
-		glVertex2f(getXAxis(col, 0.75), getYAxis(row, 0.55));
-		glVertex2f(getXAxis(col, 0.25), getYAxis(row, 0.55));
-	glEnd();
+		_batch.vertex(getXAxis(col, 0.25), getYAxis(row, 0.45));
+		_batch.vertex(getXAxis(col, 0.75), getYAxis(row, 0.45));
+		_batch.vertex(getXAxis(col, 0.75), getYAxis(row, 0.55));
+		_batch.vertex(getXAxis(col, 0.25), getYAxis(row, 0.55));
+	_batch.end();
 
-	glBegin(GL_QUADS);
-		glColor3f(0.9f, 0.9f, 0.9f);
+	_batch.begin(GL_QUADS);
+		_batch.color(0.9f, 0.9f, 0.9f);
 
-		glVertex2f(getXAxis(col, 0.4), getYAxis(row, 0.52));
-		glVertex2f(getXAxis(col, 0.4), getYAxis(row, 0.6));
-		glVertex2f(getXAxis(col, 0.48), getYAxis(row, 0.6));
-		glVertex2f(getXAxis(col, 0.48), getYAxis(row, 0.52));
-	glEnd();
+		_batch.vertex(getXAxis(col, 0.4), getYAxis(row, 0.52));
+		_batch.vertex(getXAxis(col, 0.4), getYAxis(row, 0.6));
+		_batch.vertex(getXAxis(col, 0.48), getYAxis(row, 0.6));
+		_batch.vertex(getXAxis(col, 0.48), getYAxis(row, 0.52));
+	_batch.end();
 
 
 }
@@ -284,143 +360,261 @@ void Gui::drawNumber(int row, int col, int number) {
 	float x1=0.275, x2=0.325, x3=0.375, x4=0.625, x5=0.675, x6=0.725;
 	float y1=0.1, y2=0.15, y3=0.2, y4=0.45, y5=0.5, y6=0.55, y7=0.8, y8=0.85, y9=0.9;
 
-	glColor3f(0.1f, 0.1f, 0.1f);
+	_batch.color(0.1f, 0.1f, 0.1f);
 	if(number==1)
-		glColor3f(0, 0, 1);
+		_batch.color(0, 0, 1);
 	else if(number==2)
-		glColor3f(0, 1, 0);
+		_batch.color(0, 1, 0);
 	else if(number==3)
-		glColor3f(1, 0, 0);
+		_batch.color(1, 0, 0);
 	else if(number==4)
-		glColor3f(0, 0, 0.5f);
+		_batch.color(0, 0, 0.5f);
 	else if(number==5)
-		glColor3f(0.5f, 0, 0);
+		_batch.color(0.5f, 0, 0);
 	else if(number==6)
-		glColor3f(0.5f, 0.5f, 0);
+		_batch.color(0.5f, 0.5f, 0);
 	else if(number==7)
-		glColor3f(0, 1, 1);
+		_batch.color(0, 1, 1);
 	else if(number==8)
-		glColor3f(0, 0.5f, 0.5f);
+		_batch.color(0, 0.5f, 0.5f);
 
 	//top horizontal
 	if(number==2 || number==3 || number==5 || number==6 || number==7 || number==8 || number==9) {
-		glBegin(GL_POLYGON);
-			glVertex2f(getXAxis(col, x2), getYAxis(row, y8));
-			glVertex2f(getXAxis(col, x3), getYAxis(row, y9));
-			glVertex2f(getXAxis(col, x4), getYAxis(row, y9));
-			glVertex2f(getXAxis(col, x5), getYAxis(row, y8));
-			glVertex2f(getXAxis(col, x4), getYAxis(row, y7));
-			glVertex2f(getXAxis(col, x3), getYAxis(row, y7));
-		glEnd();
+		_batch.begin(GL_POLYGON);
+			_batch.vertex(getXAxis(col, x2), getYAxis(row, y8));
+			_batch.vertex(getXAxis(col, x3), getYAxis(row, y9));
+			_batch.vertex(getXAxis(col, x4), getYAxis(row, y9));
+			_batch.vertex(getXAxis(col, x5), getYAxis(row, y8));
+			_batch.vertex(getXAxis(col, x4), getYAxis(row, y7));
+			_batch.vertex(getXAxis(col, x3), getYAxis(row, y7));
+		_batch.end();
 	}
 
 	//middle horizontal
 	if(number==2 || number==3 || number==4 || number==5 || number==6 || number==8 || number==9) {
-		glBegin(GL_POLYGON);
-			glVertex2f(getXAxis(col, x2), getYAxis(row, y5));
-			glVertex2f(getXAxis(col, x3), getYAxis(row, y6));
-			glVertex2f(getXAxis(col, x4), getYAxis(row, y6));
-			glVertex2f(getXAxis(col, x5), getYAxis(row, y5));
-			glVertex2f(getXAxis(col, x4), getYAxis(row, y4));
-			glVertex2f(getXAxis(col, x3), getYAxis(row, y4));
-		glEnd();
+		_batch.begin(GL_POLYGON);
+			_batch.vertex(getXAxis(col, x2), getYAxis(row, y5));
+			_batch.vertex(getXAxis(col, x3), getYAxis(row, y6));
+			_batch.vertex(getXAxis(col, x4), getYAxis(row, y6));
+			_batch.vertex(getXAxis(col, x5), getYAxis(row, y5));
+			_batch.vertex(getXAxis(col, x4), getYAxis(row, y4));
+			_batch.vertex(getXAxis(col, x3), getYAxis(row, y4));
+		_batch.end();
 	}
 
 	//bottom horizontal
 	if(number==2 || number==3 || number==5 || number==6 || number==8 || number==9) {
-		glBegin(GL_POLYGON);
-			glVertex2f(getXAxis(col, x2), getYAxis(row, y2));
-			glVertex2f(getXAxis(col, x3), getYAxis(row, y3));
-			glVertex2f(getXAxis(col, x4), getYAxis(row, y3));
-			glVertex2f(getXAxis(col, x5), getYAxis(row, y2));
-			glVertex2f(getXAxis(col, x4), getYAxis(row, y1));
-			glVertex2f(getXAxis(col, x3), getYAxis(row, y1));
-		glEnd();
+		_batch.begin(GL_POLYGON);
+			_batch.vertex(getXAxis(col, x2), getYAxis(row, y2));
+			_batch.vertex(getXAxis(col, x3), getYAxis(row, y3));
+			_batch.vertex(getXAxis(col, x4), getYAxis(row, y3));
+			_batch.vertex(getXAxis(col, x5), getYAxis(row, y2));
+			_batch.vertex(getXAxis(col, x4), getYAxis(row, y1));
+			_batch.vertex(getXAxis(col, x3), getYAxis(row, y1));
+		_batch.end();
 	}
 
 	//top vertical left
 	if(number==4 || number==5 || number==6 || number==8 || number==9) {
-		glBegin(GL_POLYGON);
-			glVertex2f(getXAxis(col, x2), getYAxis(row, y8));
-			glVertex2f(getXAxis(col, x3), getYAxis(row, y7));
-			glVertex2f(getXAxis(col, x3), getYAxis(row, y6));
-			glVertex2f(getXAxis(col, x2), getYAxis(row, y5));
-			glVertex2f(getXAxis(col, x1), getYAxis(row, y6));
-			glVertex2f(getXAxis(col, x1), getYAxis(row, y7));
-		glEnd();
+		_batch.begin(GL_POLYGON);
+			_batch.vertex(getXAxis(col, x2), getYAxis(row, y8));
+			_batch.vertex(getXAxis(col, x3), getYAxis(row, y7));
+			_batch.vertex(getXAxis(col, x3), getYAxis(row, y6));
+			_batch.vertex(getXAxis(col, x2), getYAxis(row, y5));
+			_batch.vertex(getXAxis(col, x1), getYAxis(row, y6));
+			_batch.vertex(getXAxis(col, x1), getYAxis(row, y7));
+		_batch.end();
 	}
 
 	//top vertical right
 	if(number==1 || number==2 || number==3 || number==4  || number==7 || number==8 || number==9) {
-		glBegin(GL_POLYGON);
-			glVertex2f(getXAxis(col, x5), getYAxis(row, y8));
-			glVertex2f(getXAxis(col, x6), getYAxis(row, y7));
-			glVertex2f(getXAxis(col, x6), getYAxis(row, y6));
-			glVertex2f(getXAxis(col, x5), getYAxis(row, y5));
-			glVertex2f(getXAxis(col, x4), getYAxis(row, y6));
-			glVertex2f(getXAxis(col, x4), getYAxis(row, y7));
-		glEnd();
+		_batch.begin(GL_POLYGON);
+			_batch.vertex(getXAxis(col, x5), getYAxis(row, y8));
+			_batch.vertex(getXAxis(col, x6), getYAxis(row, y7));
+			_batch.vertex(getXAxis(col, x6), getYAxis(row, y6));
+			_batch.vertex(getXAxis(col, x5), getYAxis(row, y5));
+			_batch.vertex(getXAxis(col, x4), getYAxis(row, y6));
+			_batch.vertex(getXAxis(col, x4), getYAxis(row, y7));
+		_batch.end();
 	}
 
 	//bottom vertical left
 	if(number==2 || number==6 || number==8) {
-		glBegin(GL_POLYGON);
-			glVertex2f(getXAxis(col, x2), getYAxis(row, y5));
-			glVertex2f(getXAxis(col, x3), getYAxis(row, y4));
-			glVertex2f(getXAxis(col, x3), getYAxis(row, y3));
-			glVertex2f(getXAxis(col, x2), getYAxis(row, y2));
-			glVertex2f(getXAxis(col, x1), getYAxis(row, y3));
-			glVertex2f(getXAxis(col, x1), getYAxis(row, y4));
-		glEnd();
+		_batch.begin(GL_POLYGON);
+			_batch.vertex(getXAxis(col, x2), getYAxis(row, y5));
+			_batch.vertex(getXAxis(col, x3), getYAxis(row, y4));
+			_batch.vertex(getXAxis(col, x3), getYAxis(row, y3));
+			_batch.vertex(getXAxis(col, x2), getYAxis(row, y2));
+			_batch.vertex(getXAxis(col, x1), getYAxis(row, y3));
+			_batch.vertex(getXAxis(col, x1), getYAxis(row, y4));
+		_batch.end();
 	}
 
 	//bottom vertical right
 	if(number==1 || number==3 || number==4 || number==5 || number==6 || number==7 || number==8 || number==9) {
-		glBegin(GL_POLYGON);
-			glVertex2f(getXAxis(col, x5), getYAxis(row, y5));
-			glVertex2f(getXAxis(col, x6), getYAxis(row, y4));
-			glVertex2f(getXAxis(col, x6), getYAxis(row, y3));
-			glVertex2f(getXAxis(col, x5), getYAxis(row, y2));
-			glVertex2f(getXAxis(col, x4), getYAxis(row, y3));
-			glVertex2f(getXAxis(col, x4), getYAxis(row, y4));
-		glEnd();
+		_batch.begin(GL_POLYGON);
+			_batch.vertex(getXAxis(col, x5), getYAxis(row, y5));
+			_batch.vertex(getXAxis(col, x6), getYAxis(row, y4));
+			_batch.vertex(getXAxis(col, x6), getYAxis(row, y3));
+			_batch.vertex(getXAxis(col, x5), getYAxis(row, y2));
+			_batch.vertex(getXAxis(col, x4), getYAxis(row, y3));
+			_batch.vertex(getXAxis(col, x4), getYAxis(row, y4));
+		_batch.end();
 	}
 
 }
 
-void Gui::drawBoard(const std::vector<std::vector<Cell>>& c) {
-	glClear(GL_COLOR_BUFFER_BIT);
-	glColor3f(0.5, 0.5, 0.5);
+//generates the geometry of the whole board without touching OpenGL, so it
+//also works on an offscreen Gui
+const VertexBatch& Gui::buildBoard(const BoardView& c) {
+	_batch.clear();
+	_batch.color(0.5, 0.5, 0.5);
 
-	for(uint i=0; i < c.size(); i++) {
-		for(uint j=0; j < c[i].size(); j++) {
-			if(c[i][j].getVisibility() == UNEXPLORED) {
+	for(int i=0; i < c.height; i++) {
+		for(int j=0; j < c.width; j++) {
+			Visibility visibility = c.at(i, j).getVisibility();
+			if(visibility == UNEXPLORED) {
 				drawUnpressedSquare(i, j);
 			}
-			else if(c[i][j].getVisibility() == FLAGGED) {
+			else if(visibility == FLAGGED) {
 				drawUnpressedSquare(i, j);
 				drawFlag(i,j);
 			}
 		}
 	}
 
-	for(uint i=0; i < c.size(); i++) {
-		for(uint j=0; j < c[i].size(); j++) {
-			if(c[i][j].getVisibility() == BOMB) {
+	for(int i=0; i < c.height; i++) {
+		for(int j=0; j < c.width; j++) {
+			Cell cell = c.at(i, j);
+			if(cell.getVisibility() == BOMB) {
 				drawPressedSquare(i, j);
 				drawBomb(i,j);
 			}
-			else if(c[i][j].getVisibility() == FREE) {
+			else if(cell.getVisibility() == FREE) {
 				drawPressedSquare(i, j);
-				drawNumber(i,j,c[i][j].getContent());
+				drawNumber(i,j,cell.getContent());
 			}
 		}
 	}
 
+	return _batch;
+}
+
+void Gui::drawBoard(const BoardView& c) {
+	PROFILE_SCOPE("Gui::drawBoard");
+	glClear(GL_COLOR_BUFFER_BIT);
+	buildBoard(c).submit();
 	glFlush();
+}
+
+//draws one row per latency stage across the top of the window. Each row is
+//the stage's histogram on a log time axis from 1us (left) to 1s (right), with
+//a white mark at the 95th percentile and a yellow mark at 16.7ms (one frame)
+void Gui::drawLatencyOverlay(const LatencyTracker& latency) {
+	static const float colors[LATENCY_STAGES][3] = {{0.2f, 0.6f, 1}, {0.2f, 0.9f, 0.3f}, {1, 0.6f, 0.1f}, {1, 0.2f, 0.2f}};
+	const int shown = 20*LatencyHistogram::BUCKETS_PER_OCTAVE;
+	const float row_height = 0.1f;
+
+	_batch.clear();
+	_batch.begin(GL_QUADS);
+		_batch.color(0.05f, 0.05f, 0.05f);
+		_batch.vertex(-1, 1);
+		_batch.vertex(-1, 1-LATENCY_STAGES*row_height);
+		_batch.vertex(1, 1-LATENCY_STAGES*row_height);
+		_batch.vertex(1, 1);
+	_batch.end();
+
+	for (int s = 0; s < LATENCY_STAGES; s++) {
+		const LatencyHistogram& h = latency._stages[s];
+		float y_high = 1-s*row_height-0.01f;
+		float y_low = 1-(s+1)*row_height+0.01f;
+
+		uint64_t most = 1;
+		for (int i = 0; i < shown; i++)
+			most = h._buckets[i] > most ? h._buckets[i] : most;
+
+		_batch.begin(GL_QUADS);
+			_batch.color(colors[s][0], colors[s][1], colors[s][2]);
+			for (int i = 0; i < shown; i++) {
+				if(h._buckets[i] == 0)
+					continue;
+				float x_low = 2.0f*i/shown-1;
+				float x_high = 2.0f*(i+1)/shown-1;
+				float top = y_low+(y_high-y_low)*h._buckets[i]/most;
+				_batch.vertex(x_low, top);
+				_batch.vertex(x_low, y_low);
+				_batch.vertex(x_high, y_low);
+				_batch.vertex(x_high, top);
+			}
+		_batch.end();
+
+		float p95 = 2.0f*std::log2(std::fmax(h.percentile(0.95), 1.0))*LatencyHistogram::BUCKETS_PER_OCTAVE/shown-1;
+		float frame = 2.0f*std::log2(1e6/60)*LatencyHistogram::BUCKETS_PER_OCTAVE/shown-1;
+		_batch.begin(GL_LINES);
+			_batch.color(1, 1, 1);
+			_batch.vertex(p95, y_low);
+			_batch.vertex(p95, y_high);
+			_batch.color(1, 1, 0);
+			_batch.vertex(frame, y_low);
+			_batch.vertex(frame, y_high);
+		_batch.end();
+	}
+
+	_batch.submit();
+	glFlush();
+}
+
+//draws the duration of the last FRAME_HISTORY frames along the bottom of the
+//window, newest on the right. The strip is 33ms high and the yellow line
+//marks 16.7ms; frames over budget are drawn in red
+void Gui::drawProfilerOverlay(const Profiler& profiler) {
+	const float strip = 0.3f, budget = 1000.0f/60;
+
+	_batch.clear();
+	_batch.begin(GL_QUADS);
+		_batch.color(0.05f, 0.05f, 0.05f);
+		_batch.vertex(-1, -1+strip);
+		_batch.vertex(-1, -1);
+		_batch.vertex(1, -1);
+		_batch.vertex(1, -1+strip);
+
+		for (int age = 0; age < FRAME_HISTORY; age++) {
+			float ms = profiler.frameTime(age);
+			if(ms <= 0)
+				break;
+
+			float x_high = 1-2.0f*age/FRAME_HISTORY;
+			float x_low = 1-2.0f*(age+1)/FRAME_HISTORY;
+			float top = -1+strip*std::fmin(ms/(2*budget), 1.0f);
+			if(ms > budget)
+				_batch.color(1, 0.2f, 0.2f);
+			else
+				_batch.color(0.2f, 0.9f, 0.3f);
+			_batch.vertex(x_low, top);
+			_batch.vertex(x_low, -1);
+			_batch.vertex(x_high, -1);
+			_batch.vertex(x_high, top);
+		}
+	_batch.end();
+
+	_batch.begin(GL_LINES);
+		_batch.color(1, 1, 0);
+		_batch.vertex(-1, -1+strip/2);
+		_batch.vertex(1, -1+strip/2);
+	_batch.end();
+
+	_batch.submit();
+	glFlush();
+}
+
+void Gui::swapBuffers() {
+	PROFILE_SCOPE("glfwSwapBuffers");
 	glfwSwapBuffers(_window);
-	glfwPollEvents();
+}
 
+void Gui::pollEvents() {
+	PROFILE_SCOPE("glfwPollEvents");
+	glfwPollEvents();
 }
 
 Gui::~Gui() {
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "def.h"
+
+/*
+class History is defined in this file
+
+History records every change of visibility made to a board so moves can be
+undone and redone without limit. A step is everything one player action
+changed (an explore with its whole cascade, a flag, a chord), and only the
+cells that actually changed are kept, 8 bytes each:
+
+	changes --> every recorded change of every step, in order, in a single
+				vector. Undoing walks a step backwards restoring "before",
+				redoing walks it forwards restoring "after", so both cost the
+				same as the action did and nothing is ever copied.
+
+	steps --> for every step, the end of its changes in the changes vector.
+
+	cursor --> how many steps are currently applied. Steps past the cursor
+				can be redone until an action that changes something is
+				recorded, which drops them.
+
+The changes of an open step are appended after the steps that can be redone,
+so an action that turns out to change nothing leaves them intact.
+*/
+class History
+{
+public:
+	struct Change {
+		uint32_t idx;
+		Visibility before, after;
+	};
+
+	History();
+
+	void begin();
+	void record(int idx, Visibility before, Visibility after);
+	void commit();
+
+	template <typename F> bool undo(F restore);
+	template <typename F> bool redo(F restore);
+
+	bool canUndo() const;
+	bool canRedo() const;
+	size_t memory() const;
+
+private:
+	size_t stepStart(size_t step) const;
+
+	std::vector<Change> _changes;
+	std::vector<size_t> _steps;
+	size_t _cursor;
+	//start in _changes of the step being recorded
+	size_t _open;
+};
+
+
+inline History::History() : _cursor(0), _open(0) {}
+
+//first index of step in _changes
+inline size_t History::stepStart(size_t step) const {
+	return step == 0 ? 0 : _steps[step-1];
+}
+
+//starts recording a new step
+inline void History::begin() {
+	_open = _changes.size();
+}
+
+inline void History::record(int idx, Visibility before, Visibility after) {
+	_changes.push_back({(uint32_t)idx, before, after});
+}
+
+//closes the step opened by begin. A step that changed nothing is dropped,
+//otherwise anything that could have been redone is lost
+inline void History::commit() {
+	if(_changes.size() == _open)
+		return;
+
+	if(_cursor < _steps.size()) {
+		_changes.erase(_changes.begin()+stepStart(_cursor), _changes.begin()+_open);
+		_steps.resize(_cursor);
+	}
+	_steps.push_back(_changes.size());
+	_cursor++;
+}
+
+//calls restore(change, visibility) for every change of the last applied
+//step, newest first, with the visibility to go back to
+template <typename F>
+bool History::undo(F restore) {
+	if(!canUndo())
+		return false;
+
+	_cursor--;
+	for (size_t i = _steps[_cursor]; i > stepStart(_cursor); i--)
+		restore(_changes[i-1], _changes[i-1].before);
+	return true;
+}
+
+//calls restore(change, visibility) for every change of the first undone
+//step, oldest first, with the visibility to go forward to
+template <typename F>
+bool History::redo(F restore) {
+	if(!canRedo())
+		return false;
+
+	for (size_t i = stepStart(_cursor); i < _steps[_cursor]; i++)
+		restore(_changes[i], _changes[i].after);
+	_cursor++;
+	return true;
+}
+
+inline bool History::canUndo() const {
+	return _cursor > 0;
+}
+
+inline bool History::canRedo() const {
+	return _cursor < _steps.size();
+}
+
+//bytes used by the recorded steps
+inline size_t History::memory() const {
+	return _changes.capacity()*sizeof(Change)+_steps.capacity()*sizeof(size_t);
+}
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <ostream>
+#include "def.h"
+
+/*
+classes LatencyHistogram and LatencyTracker are defined in this file
+
+A click goes through four timestamps before the player sees its result:
+
+	pressed --> the GLFW mouse callback in Gui::mouseButtonCallback.
+	applied --> the logic thread finished updating the game state in Board.
+	submitted --> the render thread finished submitting the frame that first
+				contains the update (end of Gui::drawBoard).
+	presented --> glfwSwapBuffers returned for that frame.
+
+LatencyTracker turns those into one histogram per stage (plus the end-to-end
+total) that can be dumped as JSON or drawn by Gui as an overlay.
+
+LatencyHistogram buckets are logarithmic, with BUCKETS_PER_OCTAVE buckets per
+doubling starting at 1us, so every bucket has the same relative resolution
+(about 19%) from microseconds up to several seconds.
+*/
+enum LatencyStage {INPUT_TO_UPDATE=0, UPDATE_TO_SUBMIT=1, SUBMIT_TO_PRESENT=2, INPUT_TO_PRESENT=3, LATENCY_STAGES=4};
+
+class LatencyHistogram
+{
+public:
+	static const int BUCKETS_PER_OCTAVE = 4;
+	static const int BUCKETS = 23*BUCKETS_PER_OCTAVE;
+
+	LatencyHistogram();
+
+	void record(Clock::duration latency);
+	double percentile(double p) const;
+	static double bucketUpperBound(int bucket);
+
+	uint64_t _count, _buckets[BUCKETS];
+	double _sum_us, _min_us, _max_us;
+};
+
+class LatencyTracker
+{
+public:
+	void record(const Move& move, Clock::time_point submitted, Clock::time_point presented);
+	void writeJson(std::ostream& out) const;
+
+	static const char* stageName(int stage);
+
+	LatencyHistogram _stages[LATENCY_STAGES];
+};
+
+
+inline LatencyHistogram::LatencyHistogram() : _count(0), _buckets(), _sum_us(0), _min_us(0), _max_us(0) {}
+
+inline void LatencyHistogram::record(Clock::duration latency) {
+	double us = std::chrono::duration<double, std::micro>(latency).count();
+	if(us < 0)
+		us = 0;
+
+	int bucket = us <= 1 ? 0 : (int)(std::log2(us)*BUCKETS_PER_OCTAVE)+1;
+	if(bucket >= BUCKETS)
+		bucket = BUCKETS-1;
+
+	_buckets[bucket]++;
+	_min_us = _count == 0 || us < _min_us ? us : _min_us;
+	_max_us = us > _max_us ? us : _max_us;
+	_sum_us += us;
+	_count++;
+}
+
+//upper bound of a bucket in microseconds
+inline double LatencyHistogram::bucketUpperBound(int bucket) {
+	return std::exp2((double)bucket/BUCKETS_PER_OCTAVE);
+}
+
+//returns the upper bound of the bucket holding the p-th percentile (p in
+//[0,1]), clamped to the largest latency actually seen
+inline double LatencyHistogram::percentile(double p) const {
+	if(_count == 0)
+		return 0;
+
+	uint64_t rank = (uint64_t)std::ceil(p*_count);
+	uint64_t seen = 0;
+	for (int i = 0; i < BUCKETS; i++) {
+		seen += _buckets[i];
+		if(seen >= rank && seen > 0)
+			return std::fmin(bucketUpperBound(i), _max_us);
+	}
+	return _max_us;
+}
+
+inline const char* LatencyTracker::stageName(int stage) {
+	static const char* names[LATENCY_STAGES] = {"input_to_update", "update_to_submit", "submit_to_present", "input_to_present"};
+	return names[stage];
+}
+
+inline void LatencyTracker::record(const Move& move, Clock::time_point submitted, Clock::time_point presented) {
+	_stages[INPUT_TO_UPDATE].record(move.applied - move.pressed);
+	_stages[UPDATE_TO_SUBMIT].record(submitted - move.applied);
+	_stages[SUBMIT_TO_PRESENT].record(presented - submitted);
+	_stages[INPUT_TO_PRESENT].record(presented - move.pressed);
+}
+
+//all values are in microseconds. Only non-empty buckets are written, as
+//[upper bound, count] pairs
+inline void LatencyTracker::writeJson(std::ostream& out) const {
+	out << "{\n";
+	for (int s = 0; s < LATENCY_STAGES; s++) {
+		const LatencyHistogram& h = _stages[s];
+		out << "  \"" << stageName(s) << "\": {"
+			<< "\"count\": " << h._count
+			<< ", \"mean_us\": " << (h._count ? h._sum_us/h._count : 0)
+			<< ", \"min_us\": " << h._min_us
+			<< ", \"p50_us\": " << h.percentile(0.5)
+			<< ", \"p95_us\": " << h.percentile(0.95)
+			<< ", \"p99_us\": " << h.percentile(0.99)
+			<< ", \"max_us\": " << h._max_us
+			<< ", \"buckets\": [";
+
+		bool first = true;
+		for (int i = 0; i < LatencyHistogram::BUCKETS; i++)
+			if(h._buckets[i]) {
+				out << (first ? "" : ", ") << "[" << LatencyHistogram::bucketUpperBound(i) << ", " << h._buckets[i] << "]";
+				first = false;
+			}
+		out << "]}" << (s+1 < LATENCY_STAGES ? "," : "") << "\n";
+	}
+	out << "}\n";
+}
@@ -0,0 +1,252 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <vector>
+#include "def.h"
+#include "solver.h"
+#include "probability_solver.h"
+#include "worker_pool.h"
+
+/*
+classes LookaheadSearch and LookaheadSolver are defined in this file
+
+The cell least likely to be a bomb is the safest guess for one move, not
+always for the game: a slightly riskier cell may show a number that settles
+its neighbours, where the safest one only leaves another guess behind it.
+LookaheadSearch weighs the LOOKAHEAD_CANDIDATES safest cells by the chance
+of surviving the next moves:
+
+	reveal --> exploring a cell that may show the numbers n: the board is
+				forked with n written in the cell, one fork per n, and
+				ProbabilityEngine computes every fork. The placements
+				consistent with each fork (logPlacements()) give the odds of
+				n. The chance of surviving is the chance the cell is safe
+				times, on average over n, the chance of surviving the moves
+				that follow on the fork.
+
+	depth --> how many reveals are simulated after the first one. On a fork,
+				the best of its own candidates is played until depth is
+				reached, and then the chance of surviving is that of its
+				safest cell. A fork with no cell left that may be safe is a
+				win.
+
+A fork is the copy of the contents a thread works on, changed and restored in
+place. Every thread has its own engine: from one number to the next only the
+codes around the cell change, and the components come from the shared
+ComponentCache. The candidates of the first move are shared between the
+threads, those of a WorkerPool (see worker_pool.h) the search starts once.
+The search gives up at a deadline, short enough for interactive hints, and
+on boards past PROBABILITY_EXACT_COMBINE, where the engine does not count
+placements.
+
+LookaheadSolver plays like ProbabilitySolver, but its guesses come from the
+search when it finishes in time.
+*/
+#define LOOKAHEAD_CANDIDATES 6
+#define LOOKAHEAD_DEPTH 1
+#define LOOKAHEAD_BUDGET_MS 50
+
+class LookaheadSearch
+{
+public:
+	explicit LookaheadSearch(int threads = 1, int candidates = LOOKAHEAD_CANDIDATES, int depth = LOOKAHEAD_DEPTH);
+
+	bool choose(const Observation& board, const std::vector<float>& probabilities, Clock::time_point deadline, Action& action);
+	//the chance of surviving of the move of the last call to choose()
+	double chance() const { return _chance; }
+	WorkerPool& pool() { return _pool; }
+
+private:
+	//the state of one thread of the search
+	struct Worker {
+		ProbabilityEngine engine;
+		std::vector<int8_t> contents;
+		//the probabilities of the forks and their candidates, per reveal
+		std::vector<std::vector<float>> levels;
+		std::vector<std::vector<int>> picks;
+		Clock::time_point deadline;
+		bool failed;
+	};
+
+	void pick(const Observation& board, const std::vector<float>& probabilities, std::vector<int>& picked) const;
+	double reveal(Worker& worker, const Observation& fork, int idx, float probability, int level) const;
+	double survive(Worker& worker, const Observation& fork, const std::vector<float>& probabilities, int level) const;
+
+	int _candidates, _depth;
+	std::vector<Worker> _workers;
+	WorkerPool _pool;
+	std::vector<int> _first;
+	std::vector<double> _chances;
+	double _chance;
+};
+
+class LookaheadSolver : public ProbabilitySolver
+{
+public:
+	explicit LookaheadSolver(unsigned seed, int threads = 1, Clock::duration budget = std::chrono::milliseconds(LOOKAHEAD_BUDGET_MS))
+		: ProbabilitySolver(seed), _search(threads), _budget(budget) {}
+
+	const char* name() const override { return "lookahead"; }
+
+protected:
+	Action guess(const Observation& board) override;
+	Action guess(const Observation& board, Clock::time_point deadline);
+	//the threads of the search, for subclasses with searches of their own
+	WorkerPool& pool() { return _search.pool(); }
+
+private:
+	LookaheadSearch _search;
+	Clock::duration _budget;
+};
+
+inline void registerLookaheadSolver() {
+	registerSolver("lookahead", [](unsigned seed) { return std::unique_ptr<Solver>(new LookaheadSolver(seed)); });
+}
+
+
+/*************************************************************************
+LookaheadSearch
+*************************************************************************/
+
+//forks are not sampled: their large components count with the interior
+inline LookaheadSearch::LookaheadSearch(int threads, int candidates, int depth)
+	: _candidates(candidates), _depth(depth), _workers(std::max(threads, 1)), _pool(threads), _chance(0) {
+	for (Worker& worker : _workers)
+		worker.engine.setSampling(1, Clock::duration::zero());
+}
+
+//finds the candidate with the best chance of surviving, spreading them over
+//the threads. Returns false if the search did not end by deadline, or can't
+//be done on this board
+inline bool LookaheadSearch::choose(const Observation& board, const std::vector<float>& probabilities, Clock::time_point deadline, Action& action) {
+	int cells = board.height*board.width;
+	pick(board, probabilities, _first);
+	if(_first.empty())
+		return false;
+
+	_chances.assign(_first.size(), 0);
+	std::atomic<int> next(0);
+	std::atomic<bool> failed(false);
+	_pool.run((int)_first.size(), [&](int t) {
+		Worker& worker = _workers[t];
+		worker.contents.assign(board.contents, board.contents+cells);
+		worker.levels.resize(_depth+1);
+		worker.picks.resize(_depth+1);
+		worker.deadline = deadline;
+		worker.failed = false;
+		Observation fork = {worker.contents.data(), board.height, board.width, board.bomb_cnt, nullptr, nullptr};
+		for (int i = next++; i < (int)_first.size() && !failed; i = next++) {
+			_chances[i] = reveal(worker, fork, _first[i], probabilities[_first[i]], 0);
+			if(worker.failed)
+				failed = true;
+		}
+	});
+	if(failed)
+		return false;
+
+	//candidates are sorted by probability: ties go to the safest
+	int best = 0;
+	for (int i = 1; i < (int)_first.size(); i++)
+		if(_chances[i] > _chances[best]+1e-9)
+			best = i;
+	_chance = _chances[best];
+	action = {_first[best]/board.width, _first[best]%board.width, LEFT};
+	return true;
+}
+
+//the _candidates unexplored cells least likely to be bombs, safest first,
+//leaving out the certain bombs
+inline void LookaheadSearch::pick(const Observation& board, const std::vector<float>& probabilities, std::vector<int>& picked) const {
+	picked.clear();
+	for (int idx = 0; idx < board.height*board.width; idx++)
+		if(board.contents[idx] == UNEXPLORED && probabilities[idx] < 1-1e-6f)
+			picked.push_back(idx);
+	auto safer = [&](int a, int b) { return probabilities[a] < probabilities[b] || (probabilities[a] == probabilities[b] && a < b); };
+	int kept = std::min(_candidates, (int)picked.size());
+	std::partial_sort(picked.begin(), picked.begin()+kept, picked.end(), safer);
+	picked.resize(kept);
+}
+
+//the chance of surviving exploring idx, a bomb with probability probability,
+//and the moves after it up to the depth. The forks of idx are computed in
+//worker.levels[level]
+inline double LookaheadSearch::reveal(Worker& worker, const Observation& fork, int idx, float probability, int level) const {
+	int row = idx/fork.width, col = idx%fork.width, known = 0, open = 0;
+	for (int i = std::max(row-1, 0); i <= std::min(row+1, fork.height-1); i++)
+		for (int j = std::max(col-1, 0); j <= std::min(col+1, fork.width-1); j++) {
+			int content = fork.contents[i*fork.width+j];
+			known += content == FLAGGED || content == BOMB;
+			open += content == UNEXPLORED && (i != row || j != col);
+		}
+
+	std::vector<float>& probabilities = worker.levels[level];
+	double logs[9], chances[9], most = -INFINITY;
+	int last = std::min(known+open, 8);
+	for (int n = known; n <= last && !worker.failed; n++) {
+		worker.contents[idx] = n;
+		worker.engine.compute(fork, probabilities);
+		logs[n] = worker.engine.logPlacements();
+		if(std::isnan(logs[n]) || Clock::now() > worker.deadline) {
+			worker.failed = true;
+			break;
+		}
+		chances[n] = logs[n] > -INFINITY ? survive(worker, fork, probabilities, level+1) : 0;
+		most = std::max(most, logs[n]);
+	}
+	worker.contents[idx] = UNEXPLORED;
+	if(worker.failed || most == -INFINITY)
+		return 0;
+
+	double weights = 0, chance = 0;
+	for (int n = known; n <= last; n++) {
+		double weight = std::exp(logs[n]-most);
+		weights += weight;
+		chance += weight*chances[n];
+	}
+	return (1-probability)*chance/weights;
+}
+
+//the chance of surviving the moves left on fork, whose probabilities are
+//given, playing the best candidates
+inline double LookaheadSearch::survive(Worker& worker, const Observation& fork, const std::vector<float>& probabilities, int level) const {
+	if(level > _depth) {
+		float safest = 1;
+		for (int idx = 0; idx < fork.height*fork.width; idx++)
+			if(fork.contents[idx] == UNEXPLORED)
+				safest = std::min(safest, probabilities[idx]);
+		return safest < 1-1e-6f ? 1-safest : 1;
+	}
+	std::vector<int>& picked = worker.picks[level];
+	pick(fork, probabilities, picked);
+	if(picked.empty())
+		return 1;
+	//a cell can't do better than its chance of being safe
+	double best = 0;
+	for (int idx : picked) {
+		if(1-probabilities[idx] <= best)
+			break;
+		best = std::max(best, reveal(worker, fork, idx, probabilities[idx], level));
+	}
+	return best;
+}
+
+
+/*************************************************************************
+LookaheadSolver
+*************************************************************************/
+
+inline Action LookaheadSolver::guess(const Observation& board) {
+	return guess(board, Clock::now()+_budget);
+}
+
+//a cell known to be safe needs no search. The deadline is that of the whole
+//move, for subclasses that spent part of it already
+inline Action LookaheadSolver::guess(const Observation& board, Clock::time_point deadline) {
+	_engine.compute(board, _probabilities);
+	Action safe = safest(board), action;
+	if(safe.row < 0 || _probabilities[safe.row*board.width+safe.col] == 0)
+		return safe;
+	return _search.choose(board, _probabilities, deadline, action) ? action : safe;
+}
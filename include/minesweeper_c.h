@@ -0,0 +1,65 @@
+#ifndef MINESWEEPER_C_H
+#define MINESWEEPER_C_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+C interface to the headless engine, for embedding it in other languages (a
+Python training loop through ctypes or cffi, for instance). It is built as
+the libminesweeper_c shared library and wraps a VectorEnv<> (see
+environment.h): a batch of boards stepped together, whose visible state is
+exported straight into the caller's buffers (see observation.h).
+
+Every buffer belongs to the caller. Strides are counted in elements, not
+bytes: board_stride between the first cells of two boards, plane_stride
+between two one-hot planes of the same board and row_stride between two
+rows of the same plane.
+
+No C++ exception crosses this interface. minesweeper_env_create returns NULL
+when it fails, the functions returning int return -1, and those that export
+leave the buffer in an unspecified state and return -1.
+*/
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* the values of minesweeper_action.button. An action with any other button
+   leaves its board as it is, like one outside the board */
+#define MINESWEEPER_FLAG 0
+#define MINESWEEPER_EXPLORE 1
+#define MINESWEEPER_CHORD 2
+
+/* number of one-hot planes, the codes are getContent()+3 */
+#define MINESWEEPER_CODES 12
+
+typedef struct minesweeper_env minesweeper_env;
+
+typedef struct minesweeper_action {
+	int row, col, button;
+} minesweeper_action;
+
+minesweeper_env* minesweeper_env_create(int count, int height, int width, int bombs, unsigned seed);
+void minesweeper_env_destroy(minesweeper_env* env);
+
+int minesweeper_env_size(const minesweeper_env* env);
+int minesweeper_env_height(const minesweeper_env* env);
+int minesweeper_env_width(const minesweeper_env* env);
+
+/* rewards and dones hold one entry per board, see VectorEnv::step. Both
+   return 0, or -1 if they failed */
+int minesweeper_env_reset(minesweeper_env* env);
+int minesweeper_env_step(minesweeper_env* env, const minesweeper_action* actions, float* rewards, uint8_t* dones);
+
+/* the exports return 0, or -1 if they failed */
+int minesweeper_env_contents(const minesweeper_env* env, int8_t* out, ptrdiff_t board_stride, ptrdiff_t row_stride);
+int minesweeper_env_codes(const minesweeper_env* env, uint8_t* out, ptrdiff_t board_stride, ptrdiff_t row_stride);
+int minesweeper_env_values(const minesweeper_env* env, float* out, ptrdiff_t board_stride, ptrdiff_t row_stride);
+int minesweeper_env_one_hot_u8(const minesweeper_env* env, uint8_t* out, ptrdiff_t board_stride, ptrdiff_t plane_stride, ptrdiff_t row_stride);
+int minesweeper_env_one_hot_f32(const minesweeper_env* env, float* out, ptrdiff_t board_stride, ptrdiff_t plane_stride, ptrdiff_t row_stride);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
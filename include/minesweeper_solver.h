@@ -0,0 +1,48 @@
+#ifndef MINESWEEPER_SOLVER_H
+#define MINESWEEPER_SOLVER_H
+
+#include "minesweeper_c.h"
+
+/*
+C interface for solver plugins. A plugin is a shared library, written in any
+language that can export C functions, that the tournament (and anything else
+using solver_plugin.h) loads at run time with dlopen. It exports one
+function, minesweeper_get_solver, returning a table of callbacks that stays
+valid as long as the library is loaded.
+
+The board is passed as in minesweeper_env_contents: height*width int8_t
+values, row by row, each the number of bombs around an explored cell or one
+of MINESWEEPER_BOMB, MINESWEEPER_UNEXPLORED and MINESWEEPER_FLAGGED. Every
+instance made by create is used by one thread at a time.
+
+abi_version must be MINESWEEPER_SOLVER_ABI; it only changes when this table
+does, and plugins built against another version are refused.
+*/
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MINESWEEPER_SOLVER_ABI 1
+#define MINESWEEPER_SOLVER_ENTRY "minesweeper_get_solver"
+
+#define MINESWEEPER_BOMB -1
+#define MINESWEEPER_UNEXPLORED -2
+#define MINESWEEPER_FLAGGED -3
+
+typedef struct minesweeper_solver_plugin {
+	int abi_version;
+	const char* name;
+	void* (*create)(unsigned seed);
+	void (*destroy)(void* solver);
+	/* may be NULL */
+	void (*new_game)(void* solver, int height, int width, int bombs);
+	minesweeper_action (*next_move)(void* solver, const int8_t* contents, int height, int width, int bombs);
+} minesweeper_solver_plugin;
+
+const minesweeper_solver_plugin* minesweeper_get_solver(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
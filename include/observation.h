@@ -0,0 +1,165 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "def.h"
+#include "cell.h"
+#include "grid.h"
+#include "profiler.h"
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/*
+The functions in this file copy what the player sees of a board, the
+getContent() value of every cell, into a caller's buffer, for feeding neural
+networks. They read the layout and visibility of a BoardView directly, 16
+cells at a time with SSE2 where available, instead of building a Cell and
+calling getContent() for every one of them.
+
+Every export is row by row with a row stride given in elements, so the rows
+can land in a bigger tensor (a batch, padding, several channels...). The
+cell values can be written as:
+
+	contents --> int8_t, exactly getContent(): 0 to 8 bombs around an
+				explored cell, BOMB, UNEXPLORED or FLAGGED otherwise.
+
+	codes --> uint8_t, getContent()-FLAGGED, so every value is in
+				[0, OBSERVATION_CODES), ready for an embedding lookup.
+
+	values --> float, getContent() converted.
+
+	one-hot --> OBSERVATION_CODES planes of 0 and 1 (uint8_t or float), plane
+				k holding 1 where the code is k, plane_stride elements apart.
+*/
+#define OBSERVATION_CODES (8-FLAGGED+1)
+
+//writes the getContent() value of n consecutive cells. layout and visibility
+//point at the first one in the padded storage of a board (see board_state.h)
+inline void observeCells(const Cell* layout, const Visibility* visibility, int8_t* out, int n) {
+	//a Cell is its visibility byte followed by its content byte (see cell.h)
+	static_assert(sizeof(Cell) == 2, "the observation kernels expect 2 byte cells");
+	const int8_t* cells = reinterpret_cast<const int8_t*>(layout);
+	const int8_t* seen = reinterpret_cast<const int8_t*>(visibility);
+	int i = 0;
+
+#if defined(__SSE2__)
+	const __m128i free = _mm_set1_epi8(FREE);
+	for (; i+16 <= n; i += 16) {
+		//the arithmetic shift keeps the high (content) byte of every cell
+		__m128i low = _mm_srai_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(cells+2*i)), 8);
+		__m128i high = _mm_srai_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(cells+2*i+16)), 8);
+		__m128i content = _mm_packs_epi16(low, high);
+		__m128i state = _mm_loadu_si128(reinterpret_cast<const __m128i*>(seen+i));
+		__m128i explored = _mm_cmpeq_epi8(state, free);
+		__m128i value = _mm_or_si128(_mm_and_si128(explored, content), _mm_andnot_si128(explored, state));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(out+i), value);
+	}
+#endif
+
+	for (; i < n; i++)
+		out[i] = seen[i] == FREE ? cells[2*i+1] : seen[i];
+}
+
+inline void exportContents(const BoardView& view, int8_t* out, ptrdiff_t row_stride) {
+	PROFILE_SCOPE("exportContents");
+	for (int row = 0; row < view.height; row++) {
+		int idx = (row+1)*view.stride+1;
+		observeCells(view.layout+idx, view.visibility+idx, out+row*row_stride, view.width);
+	}
+}
+
+//the other formats go through a small buffer of contents and convert it a
+//chunk at a time. f(offset, chunk, n) gets n contents to write from
+//out+offset on. When the rows are packed (row_stride == width) a chunk runs
+//on from one row to the next, so narrow boards still get long runs
+#define OBSERVATION_CHUNK 256
+
+template <typename F>
+void forEachObservedChunk(const BoardView& view, ptrdiff_t row_stride, F f) {
+	int8_t chunk[OBSERVATION_CHUNK];
+	int filled = 0;
+	ptrdiff_t start = 0;
+	bool packed = row_stride == view.width;
+
+	for (int row = 0; row < view.height; row++)
+		for (int col = 0; col < view.width; ) {
+			int idx = (row+1)*view.stride+col+1;
+			int n = view.width-col < OBSERVATION_CHUNK-filled ? view.width-col : OBSERVATION_CHUNK-filled;
+			observeCells(view.layout+idx, view.visibility+idx, chunk+filled, n);
+			if(filled == 0)
+				start = row*row_stride+col;
+			filled += n;
+			col += n;
+
+			if(!packed || filled == OBSERVATION_CHUNK) {
+				f(start, chunk, filled);
+				filled = 0;
+			}
+		}
+
+	if(filled)
+		f(start, chunk, filled);
+}
+
+inline void exportCodes(const BoardView& view, uint8_t* out, ptrdiff_t row_stride) {
+	PROFILE_SCOPE("exportCodes");
+	forEachObservedChunk(view, row_stride, [&](ptrdiff_t offset, const int8_t* chunk, int n) {
+		uint8_t* dst = out+offset;
+		for (int i = 0; i < n; i++)
+			dst[i] = (uint8_t)(chunk[i]-FLAGGED);
+	});
+}
+
+inline void exportValues(const BoardView& view, float* out, ptrdiff_t row_stride) {
+	PROFILE_SCOPE("exportValues");
+	forEachObservedChunk(view, row_stride, [&](ptrdiff_t offset, const int8_t* chunk, int n) {
+		float* dst = out+offset;
+		for (int i = 0; i < n; i++)
+			dst[i] = chunk[i];
+	});
+}
+
+//writes 1 where contents[i] == content and 0 elsewhere, for n cells
+inline void oneHotCells(const int8_t* contents, int8_t content, uint8_t* out, int n) {
+	int i = 0;
+#if defined(__SSE2__)
+	const __m128i match = _mm_set1_epi8(content);
+	const __m128i one = _mm_set1_epi8(1);
+	for (; i+16 <= n; i += 16) {
+		__m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i*>(contents+i));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(out+i), _mm_and_si128(_mm_cmpeq_epi8(value, match), one));
+	}
+#endif
+	for (; i < n; i++)
+		out[i] = contents[i] == content;
+}
+
+inline void oneHotCells(const int8_t* contents, int8_t content, float* out, int n) {
+	int i = 0;
+#if defined(__SSE2__)
+	const __m128i match = _mm_set1_epi8(content);
+	const __m128i one = _mm_castps_si128(_mm_set1_ps(1.0f));
+	for (; i+16 <= n; i += 16) {
+		//widen the byte masks to 32 bits and keep the bits of 1.0f under them
+		__m128i mask = _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(contents+i)), match);
+		__m128i low = _mm_unpacklo_epi8(mask, mask);
+		__m128i high = _mm_unpackhi_epi8(mask, mask);
+		__m128i words[4] = {_mm_unpacklo_epi16(low, low), _mm_unpackhi_epi16(low, low), _mm_unpacklo_epi16(high, high), _mm_unpackhi_epi16(high, high)};
+		for (int k = 0; k < 4; k++)
+			_mm_storeu_ps(out+i+4*k, _mm_castsi128_ps(_mm_and_si128(words[k], one)));
+	}
+#endif
+	for (; i < n; i++)
+		out[i] = contents[i] == content;
+}
+
+//T is uint8_t or float
+template <typename T>
+void exportOneHot(const BoardView& view, T* out, ptrdiff_t plane_stride, ptrdiff_t row_stride) {
+	PROFILE_SCOPE("exportOneHot");
+	forEachObservedChunk(view, row_stride, [&](ptrdiff_t offset, const int8_t* chunk, int n) {
+		for (int code = 0; code < OBSERVATION_CODES; code++)
+			oneHotCells(chunk, code+FLAGGED, out+code*plane_stride+offset, n);
+	});
+}
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <vector>
+#include "def.h"
+#include "cell.h"
+#include "grid.h"
+
+/*
+class OpeningIndex is defined in this file
+
+An opening is a region of connected zero cells (8 neighbours). Exploring any
+of them explores all of them and their border, the numbers around them, so
+the cells an explore reveals are known as soon as the bombs are placed.
+OpeningIndex lists them once per layout:
+
+	opening --> for every cell of the padded storage, the id of the opening
+				it is a zero of, -1 for the numbers, the bombs and the
+				sentinels.
+
+	span --> for every opening, its zeros and its border in one contiguous
+				run of _cells, in the order a flood fill from its first zero
+				finds them. A number next to several openings is in each of
+				their spans.
+
+The index is built with the layout and never changes with the game, so a
+state and its forks share it like the layout. When bombs move after the
+layout is made (see BoardState::setSafeFirstClick), update() only rebuilds the
+openings around the cells whose content changed: their old ids are retired
+(an empty span) and the regions found again get new ids, their spans appended
+to _cells. Every other opening keeps its id and its span.
+*/
+template <int H = 0, int W = 0>
+class OpeningIndex
+{
+public:
+	typedef typename Grid<H, W>::template Array<Cell> Layout;
+
+	void build(const Grid<H, W>& grid, const Layout& layout);
+	void update(const Grid<H, W>& grid, const Layout& layout, const std::vector<int>& changed);
+
+	int opening(int idx) const { return _opening[idx]; }
+	const int* begin(int id) const { return _cells.data()+_first[id]; }
+	const int* end(int id) const { return _cells.data()+_first[id]+_count[id]; }
+	int count() const { return (int)_first.size(); }
+
+private:
+	void flood(const Grid<H, W>& grid, const Layout& layout, int start);
+
+	typename Grid<H, W>::template Array<int> _opening;
+	//the id of the last opening whose span a cell was added to, so that a
+	//border cell is listed once per opening
+	typename Grid<H, W>::template Array<int> _listed;
+	std::vector<int> _first, _count;
+	std::vector<int> _cells;
+	std::vector<int> _stack;
+};
+
+
+template <int H, int W>
+void OpeningIndex<H, W>::build(const Grid<H, W>& grid, const Layout& layout) {
+	grid.allocate(_opening, -1, -1);
+	grid.allocate(_listed, -1, -1);
+	_first.clear();
+	_count.clear();
+	_cells.clear();
+	grid.forEachCell([&](int idx) {
+		if(layout[idx].getContent() == 0 && _opening[idx] < 0)
+			flood(grid, layout, idx);
+	});
+}
+
+//labels the opening of the zero start with a new id and appends its span
+template <int H, int W>
+void OpeningIndex<H, W>::flood(const Grid<H, W>& grid, const Layout& layout, int start) {
+	int id = (int)_first.size();
+	_first.push_back((int)_cells.size());
+	_opening[start] = _listed[start] = id;
+	_cells.push_back(start);
+	_stack.assign(1, start);
+
+	while(!_stack.empty()) {
+		int idx = _stack.back();
+		_stack.pop_back();
+		grid.forEachNeighbour(idx, [&](int n) {
+			int content = layout[n].getContent();
+			if(_listed[n] == id || content < 0)
+				return;
+			_listed[n] = id;
+			_cells.push_back(n);
+			if(content == 0) {
+				_opening[n] = id;
+				_stack.push_back(n);
+			}
+		});
+	}
+	_count.push_back((int)_cells.size()-_first[id]);
+}
+
+//brings the index up to date after the contents of the cells in changed
+//did, none of which is a sentinel. Only the openings within one cell of them
+//can have changed
+template <int H, int W>
+void OpeningIndex<H, W>::update(const Grid<H, W>& grid, const Layout& layout, const std::vector<int>& changed) {
+	//the zeros of the retired openings may now be in other openings, or in
+	//none
+	std::vector<int> seeds;
+	auto retire = [&](int idx) {
+		int id = _opening[idx];
+		if(id < 0 || _count[id] == 0)
+			return;
+		for (const int* cell = begin(id); cell != end(id); cell++)
+			if(_opening[*cell] == id) {
+				_opening[*cell] = -1;
+				seeds.push_back(*cell);
+			}
+		_count[id] = 0;
+	};
+	for (int idx : changed) {
+		retire(idx);
+		grid.forEachNeighbour(idx, retire);
+		seeds.push_back(idx);
+	}
+
+	for (int idx : seeds)
+		if(layout[idx].getContent() == 0 && _opening[idx] < 0)
+			flood(grid, layout, idx);
+}
@@ -0,0 +1,208 @@
+#pragma once
+
+#include <cstdint>
+#include "def.h"
+#include "solver.h"
+#include "basic_solvers.h"
+
+/*
+the pair pattern table and class PatternSolver are defined in this file
+
+Most deductions the single-cell rule misses come from two numbers close
+enough to share unexplored neighbours (the 1-1 and 1-2 patterns along a
+wall, and all their rotations and variants). Whatever the shape, the two
+numbers A and B split the unexplored cells around them in three regions:
+
+	only A --> around A but not around B.
+
+	shared --> around both. There are at most 4 of them, when A and B are
+				side by side.
+
+	only B --> around B but not around A.
+
+Cells of the same region are interchangeable, so what the pair forces only
+depends on how many unexplored cells each region holds and how many bombs
+each number still misses (its number minus the flags around it). The table
+below holds the answer for every such pattern: for each region, whether its
+cells are all safe, all bombs or undecided. It is keyed on the number of
+unexplored cells of only A (0 to 8), shared (0 to PATTERN_SHARED_MAX) and
+only B (0 to 8) and on the bombs A and B miss (0 to 8 each), and filled in
+by the compiler, so nothing runs at start-up. It is 32KB, small enough to
+stay in cache next to the board.
+
+PatternSolver looks at every number with the 12 numbers at most 2 rows and
+2 columns away from it that come after it (every pair once). It reads the
+7x7 window of the board around the first number once, as a mask of its
+UNEXPLORED cells and a mask of its FLAGGED cells, 49 bits each; the regions
+of each pair are then fixed masks of the window, and a pattern is a handful
+of popcounts and one table lookup.
+*/
+#define PATTERN_SHARED_MAX 4
+#define PATTERN_PAIRS 12
+
+enum PatternForced : uint8_t {ONLY_A_SAFE=1, ONLY_A_BOMBS=2, SHARED_SAFE=4, SHARED_BOMBS=8, ONLY_B_SAFE=16, ONLY_B_BOMBS=32};
+
+struct PairPatterns {
+	//indexed by patternIndex(), a combination of PatternForced
+	uint8_t forced[9*(PATTERN_SHARED_MAX+1)*9*9*9];
+};
+
+constexpr int patternIndex(int only_a, int shared, int only_b, int missing_a, int missing_b) {
+	return (((only_a*(PATTERN_SHARED_MAX+1)+shared)*9+only_b)*9+missing_a)*9+missing_b;
+}
+
+//tries every number of bombs in the shared region and keeps, for every
+//region, the fewest and the most bombs of the splits that satisfy both numbers
+constexpr uint8_t solvePattern(int only_a, int shared, int only_b, int missing_a, int missing_b) {
+	int unexplored[3] = {only_a, shared, only_b};
+	int fewest[3] = {9, 9, 9}, most[3] = {-1, -1, -1};
+	for (int in_shared = 0; in_shared <= shared; in_shared++) {
+		int bombs[3] = {missing_a-in_shared, in_shared, missing_b-in_shared};
+		if(bombs[0] < 0 || bombs[0] > only_a || bombs[2] < 0 || bombs[2] > only_b)
+			continue;
+		for (int r = 0; r < 3; r++) {
+			fewest[r] = bombs[r] < fewest[r] ? bombs[r] : fewest[r];
+			most[r] = bombs[r] > most[r] ? bombs[r] : most[r];
+		}
+	}
+
+	uint8_t forced = 0;
+	for (int r = 0; r < 3; r++) {
+		if(unexplored[r] == 0 || most[r] < 0)
+			continue;
+		if(most[r] == 0)
+			forced |= ONLY_A_SAFE << 2*r;
+		else if(fewest[r] == unexplored[r])
+			forced |= ONLY_A_BOMBS << 2*r;
+	}
+	return forced;
+}
+
+constexpr PairPatterns makePairPatterns() {
+	PairPatterns table = {};
+	for (int only_a = 0; only_a <= 8; only_a++)
+		for (int shared = 0; shared <= PATTERN_SHARED_MAX; shared++)
+			for (int only_b = 0; only_b <= 8; only_b++)
+				for (int missing_a = 0; missing_a <= 8; missing_a++)
+					for (int missing_b = 0; missing_b <= 8; missing_b++)
+						table.forced[patternIndex(only_a, shared, only_b, missing_a, missing_b)] = solvePattern(only_a, shared, only_b, missing_a, missing_b);
+	return table;
+}
+
+inline constexpr PairPatterns PAIR_PATTERNS = makePairPatterns();
+
+//a 1 next to a 1 along a wall: the cell only the second one sees is safe
+static_assert(PAIR_PATTERNS.forced[patternIndex(0, 2, 1, 1, 1)] == ONLY_B_SAFE, "1-1 pattern");
+//a 1 next to a 2 along a wall: the cell only the 2 sees is a bomb
+static_assert(PAIR_PATTERNS.forced[patternIndex(0, 2, 1, 1, 2)] == ONLY_B_BOMBS, "1-2 pattern");
+static_assert(PAIR_PATTERNS.forced[patternIndex(1, 2, 1, 1, 1)] == 0, "nothing forced");
+
+//bit of the cell (i, j) of the 7x7 window centred on A, -3 <= i, j <= 3
+constexpr uint64_t windowBit(int i, int j) {
+	return uint64_t(1) << ((i+3)*7+j+3);
+}
+
+//the 8 cells around (i, j) that fall in the window
+constexpr uint64_t windowAround(int i, int j) {
+	uint64_t mask = 0;
+	for (int di = -1; di <= 1; di++)
+		for (int dj = -1; dj <= 1; dj++)
+			if((di || dj) && i+di >= -3 && i+di <= 3 && j+dj >= -3 && j+dj <= 3)
+				mask |= windowBit(i+di, j+dj);
+	return mask;
+}
+
+//where B can be relative to A
+constexpr int PATTERN_OFFSETS[PATTERN_PAIRS][2] = {{0, 1}, {0, 2}, {1, -2}, {1, -1}, {1, 0}, {1, 1}, {1, 2}, {2, -2}, {2, -1}, {2, 0}, {2, 1}, {2, 2}};
+
+class PatternSolver : public SingleCellSolver
+{
+public:
+	explicit PatternSolver(unsigned seed) : SingleCellSolver(seed) {}
+
+	const char* name() const override { return "patterns"; }
+	Action nextMove(const Observation& board) override;
+
+protected:
+	bool matchPatterns(const Observation& board, Action& action) const;
+
+private:
+	bool matchPatterns(const Observation& board, int row, int col, Action& action) const;
+};
+
+inline void registerPatternSolver() {
+	registerSolver("patterns", [](unsigned seed) { return std::unique_ptr<Solver>(new PatternSolver(seed)); });
+}
+
+
+//finds a move a pair of numbers allows, if any
+inline bool PatternSolver::matchPatterns(const Observation& board, Action& action) const {
+	if(board.constraints) {
+		for (int idx : *board.constraints)
+			if(matchPatterns(board, board.row(idx), board.col(idx), action))
+				return true;
+		return false;
+	}
+
+	for (int row = 0; row < board.height; row++)
+		for (int col = 0; col < board.width; col++)
+			if(matchPatterns(board, row, col, action))
+				return true;
+	return false;
+}
+
+//looks at the number at (row, col) paired with each of the numbers after it
+inline bool PatternSolver::matchPatterns(const Observation& board, int row, int col, Action& action) const {
+	constexpr uint64_t AROUND_A = windowAround(0, 0);
+	int number = board.at(row, col);
+	if(number <= 0)
+		return false;
+
+	uint64_t unexplored = 0, flagged = 0;
+	for (int i = row-3 < 0 ? -row : -3; i <= 3 && row+i < board.height; i++)
+		for (int j = col-3 < 0 ? -col : -3; j <= 3 && col+j < board.width; j++) {
+			int content = board.at(row+i, col+j);
+			unexplored |= content == UNEXPLORED ? windowBit(i, j) : 0;
+			flagged |= content == FLAGGED ? windowBit(i, j) : 0;
+		}
+	if(!(unexplored & AROUND_A))
+		return false;
+	int missing_a = number-__builtin_popcountll(flagged & AROUND_A);
+
+	constexpr uint64_t AROUND_B[PATTERN_PAIRS] = {
+		windowAround(0, 1), windowAround(0, 2), windowAround(1, -2), windowAround(1, -1), windowAround(1, 0), windowAround(1, 1),
+		windowAround(1, 2), windowAround(2, -2), windowAround(2, -1), windowAround(2, 0), windowAround(2, 1), windowAround(2, 2)};
+	for (int k = 0; k < PATTERN_PAIRS; k++) {
+		int i = PATTERN_OFFSETS[k][0], j = PATTERN_OFFSETS[k][1];
+		if(row+i >= board.height || col+j < 0 || col+j >= board.width)
+			continue;
+		uint64_t shared = unexplored & AROUND_A & AROUND_B[k];
+		int number_b = board.at(row+i, col+j);
+		if(!shared || number_b <= 0)
+			continue;
+
+		uint64_t only_a = unexplored & AROUND_A & ~AROUND_B[k];
+		uint64_t only_b = unexplored & AROUND_B[k] & ~AROUND_A;
+		int missing_b = number_b-__builtin_popcountll(flagged & AROUND_B[k]);
+		if(missing_a < 0 || missing_a > 8 || missing_b < 0 || missing_b > 8)
+			continue;
+		int forced = PAIR_PATTERNS.forced[patternIndex(__builtin_popcountll(only_a), __builtin_popcountll(shared), __builtin_popcountll(only_b), missing_a, missing_b)];
+		if(!forced)
+			continue;
+
+		//one move per call, like the single-cell rule: the first forced region
+		const uint64_t regions[3] = {only_a, shared, only_b};
+		int r = __builtin_ctz(forced)/2;
+		int bit = __builtin_ctzll(regions[r]);
+		action = {row+bit/7-3, col+bit%7-3, forced & (ONLY_A_BOMBS << 2*r) ? RIGHT : LEFT};
+		return true;
+	}
+	return false;
+}
+
+inline Action PatternSolver::nextMove(const Observation& board) {
+	Action action;
+	if(deduce(board, action) || matchPatterns(board, action))
+		return action;
+	return guess(board);
+}
@@ -0,0 +1,727 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <unordered_set>
+#include <vector>
+#include "def.h"
+#include "solver.h"
+#include "frontier.h"
+#include "component_cache.h"
+#include "component_sampler.h"
+#include "elimination_solver.h"
+
+/*
+classes ProbabilityEngine and ProbabilitySolver are defined in this file
+
+When nothing is forced, the best single guess is the cell least likely to be
+a bomb. ProbabilityEngine computes that probability for every unexplored
+cell by counting the bomb placements consistent with the board, with the
+unexplored cells split in two kinds:
+
+	components --> the numbers with unexplored neighbours, grouped when they
+				share one, with the unexplored cells around them. They only
+				depend on each other through the total number of bombs, so
+				each is enumerated on its own and only its counts per number
+				of bombs are kept (see ComponentSolution in component_cache.h).
+				The enumeration backtracks over groups of cells around the
+				same numbers, in row-major order, by how many bombs each
+				group holds.
+
+	interior --> the unexplored cells next to no number. They are all alike:
+				placing K bombs in the components leaves C(interior,
+				remaining-K) ways to place the others.
+
+The counts of the components are then combined by convolution, every
+component weighted by the placements of all the others and of the interior,
+in time proportional to the frontier times the bombs left. Past
+PROBABILITY_EXACT_COMBINE, on very large boards, every bomb is taken to be
+somewhere with the same odds instead, whatever the total, which makes the
+components independent.
+
+Components are looked up in the shared ComponentCache before being
+enumerated. The engine keeps the code of every number from one call to the
+next, and only recomputes those around the cells that changed. A component
+of more than COMPONENT_MAX_CELLS cells, or whose enumeration takes more than
+COMPONENT_MAX_STEPS steps (a group of cells tried, or counted in a placement),
+is sampled instead (see component_sampler.h), within a time budget shared by
+all such components; with no budget, or if no sample makes it, its cells
+are counted with the interior, which is then only an approximation. Flags
+are taken to be right.
+
+The log of the number of placements itself is kept too (logPlacements()):
+comparing it between boards that only differ by one explored cell tells how
+likely each number is there (see lookahead_solver.h).
+*/
+#define COMPONENT_MAX_CELLS 256
+#define COMPONENT_MAX_STEPS (1 << 18)
+#define PROBABILITY_SAMPLE_BUDGET_MS 20
+#define PROBABILITY_EXACT_COMBINE (1 << 23)
+#define PROBABILITY_LOG_RATIO_MAX 40.0
+#define PROBABILITY_RATIO_STEPS 40
+
+class ProbabilityEngine
+{
+public:
+	explicit ProbabilityEngine(ComponentCache& cache = ComponentCache::shared())
+		: _cache(cache), _height(0), _width(0), _log_placements(0), _budget(std::chrono::milliseconds(PROBABILITY_SAMPLE_BUDGET_MS)) {}
+
+	void reset(int height, int width);
+	void setSampling(int threads, Clock::duration budget);
+	void compute(const Observation& board, std::vector<float>& probabilities, std::vector<float>* error = nullptr);
+	//the log of the placements consistent with the board of the last call
+	//to compute(): -INFINITY if there is none, NAN past
+	//PROBABILITY_EXACT_COMBINE
+	double logPlacements() const { return _log_placements; }
+
+private:
+	struct Component {
+		std::vector<int> numbers, cells;
+		std::vector<uint64_t> key;
+		uint64_t hash;
+		std::shared_ptr<const ComponentSolution> solution;
+		//the confidence of a sampled solution, empty for an exact one
+		std::vector<float> error;
+	};
+
+	void sync(const Observation& board);
+	void updateCode(const Observation& board, int idx);
+	int root(int number);
+	void findComponents(const Observation& board);
+	void describe(const Component& component);
+	std::shared_ptr<const ComponentSolution> solve();
+	bool enumerate(ComponentSolution& solution, int group, int bombs, double placements);
+	void combine(const Observation& board, std::vector<float>& probabilities);
+	void spread(const Component& component, const std::vector<double>& factor, float fallback, std::vector<float>& probabilities);
+	void combineByDensity(const Observation& board, std::vector<float>& probabilities, int remaining, int interior);
+
+	ComponentCache& _cache;
+	int _height, _width;
+	double _log_placements;
+	std::vector<int8_t> _seen;
+	//componentCode() of the numbers with unexplored neighbours, -1 elsewhere
+	std::vector<int16_t> _codes;
+	IndexedSet _numbers;
+
+	std::vector<int> _sorted;
+	std::vector<int> _parent;
+	std::vector<int> _owner;
+	std::vector<int> _component_of;
+	std::vector<int> _touched;
+	std::vector<Component> _components;
+	int _component_count;
+
+	std::vector<int> _unsolved;
+	//the hashes of the components found too large to enumerate, not to try
+	//again every call. A collision only sends a component to the sampler
+	std::unordered_set<uint64_t> _too_large;
+
+	//the component being enumerated or sampled, and where its cells are in it
+	ComponentProblem _problem;
+	std::vector<int> _local;
+	//the groups of interchangeable cells of the component being enumerated,
+	//the bombs chosen for each and their counts per number of bombs
+	std::vector<int> _group_of;
+	std::vector<int> _group_size;
+	std::vector<int> _group_first;
+	std::vector<int> _chosen;
+	std::vector<double> _group_bombs;
+	long _steps;
+	ComponentSampler _sampler;
+	Clock::duration _budget;
+
+	std::vector<const Component*> _solved;
+	std::vector<std::vector<double>> _prefix;
+	std::vector<double> _tail;
+	std::vector<double> _next;
+	std::vector<double> _weight;
+	std::vector<double> _factor;
+	std::vector<double> _log_ways;
+};
+
+/*
+ProbabilitySolver plays like EliminationSolver, but its guesses explore the
+cell least likely to be a bomb, picked at random among the equally likely
+ones.
+*/
+class ProbabilitySolver : public EliminationSolver
+{
+public:
+	explicit ProbabilitySolver(unsigned seed) : EliminationSolver(seed) {}
+
+	const char* name() const override { return "probability"; }
+	void newGame(int height, int width, int bomb_cnt) override;
+
+protected:
+	Action guess(const Observation& board) override;
+	Action safest(const Observation& board);
+
+	ProbabilityEngine _engine;
+	std::vector<float> _probabilities;
+};
+
+inline void registerProbabilitySolver() {
+	registerSolver("probability", [](unsigned seed) { return std::unique_ptr<Solver>(new ProbabilitySolver(seed)); });
+}
+
+
+/*************************************************************************
+ProbabilityEngine
+*************************************************************************/
+
+//forgets the board, for one of height x width cells all unexplored
+inline void ProbabilityEngine::reset(int height, int width) {
+	_height = height;
+	_width = width;
+	_seen.assign(height*width, UNEXPLORED);
+	_codes.assign(height*width, -1);
+	_numbers.reset(height*width);
+	_parent.assign(height*width, -1);
+	_owner.assign(height*width, -1);
+	_component_of.assign(height*width, -1);
+	_local.assign(height*width, -1);
+	_too_large.clear();
+}
+
+//writes, for every cell, the probability that it is a bomb: 0 for the
+//explored cells, 1 for the flagged ones. error, if given, gets the half width
+//of the 95% confidence interval of every probability: 0 where they are exact
+//and 1 where nothing is known (cells of components neither enumerated nor
+//sampled)
+inline void ProbabilityEngine::compute(const Observation& board, std::vector<float>& probabilities, std::vector<float>* error) {
+	sync(board);
+	findComponents(board);
+	_unsolved.clear();
+	for (int c = 0; c < _component_count; c++) {
+		Component& component = _components[c];
+		component.error.clear();
+		component.solution = _cache.find(component.hash, component.key);
+		if(component.solution)
+			continue;
+		if(!_too_large.count(component.hash)) {
+			describe(component);
+			component.solution = solve();
+		}
+		if(component.solution)
+			_cache.insert(component.hash, component.key, component.solution);
+		else {
+			_too_large.insert(component.hash);
+			_unsolved.push_back(c);
+		}
+	}
+
+	//the sampler shares the budget between the components too large to
+	//enumerate, in proportion to their cells. Its estimates are not cached
+	long unsolved_cells = 0;
+	for (int c : _unsolved)
+		unsolved_cells += _components[c].cells.size();
+	for (int c : _unsolved) {
+		Component& component = _components[c];
+		if(_budget <= Clock::duration::zero())
+			break;
+		describe(component);
+		component.solution = _sampler.sample(_problem, _budget*(long)component.cells.size()/unsolved_cells, component.error);
+	}
+	combine(board, probabilities);
+
+	if(!error)
+		return;
+	error->assign(board.height*board.width, 0);
+	for (int c = 0; c < _component_count; c++) {
+		const Component& component = _components[c];
+		for (int j = 0; j < (int)component.cells.size(); j++)
+			(*error)[component.cells[j]] = !component.solution ? 1 : component.error.empty() ? 0 : component.error[j];
+	}
+}
+
+//how the components too large to enumerate are sampled: on threads threads,
+//for at most budget per call of compute() overall. A budget of zero leaves
+//them unsolved
+inline void ProbabilityEngine::setSampling(int threads, Clock::duration budget) {
+	_sampler = ComponentSampler(threads);
+	_budget = budget;
+}
+
+//brings the codes up to date with what changed on the board since the last
+//call. A cell covered again (a new game, an undo, a fork of the lookahead
+//put back) is a change like any other
+inline void ProbabilityEngine::sync(const Observation& board) {
+	int cells = board.height*board.width;
+	if(board.height != _height || board.width != _width)
+		reset(board.height, board.width);
+
+	_touched.clear();
+	for (int idx = 0; idx < cells; idx++) {
+		if(_seen[idx] == board.contents[idx])
+			continue;
+		_seen[idx] = board.contents[idx];
+		_touched.push_back(idx);
+	}
+
+	//a code depends on the number and its 8 neighbours
+	for (int idx : _touched) {
+		int row = idx/_width, col = idx%_width;
+		for (int i = std::max(row-1, 0); i <= std::min(row+1, _height-1); i++)
+			for (int j = std::max(col-1, 0); j <= std::min(col+1, _width-1); j++)
+				updateCode(board, i*_width+j);
+	}
+	_touched.clear();
+}
+
+inline void ProbabilityEngine::updateCode(const Observation& board, int idx) {
+	int number = board.contents[idx], row = idx/_width, col = idx%_width;
+	int mask = 0, flagged = 0, bit = 0;
+	if(number >= 0)
+		for (int i = row-1; i <= row+1; i++)
+			for (int j = col-1; j <= col+1; j++) {
+				if(i == row && j == col)
+					continue;
+				if(i >= 0 && i < _height && j >= 0 && j < _width) {
+					int content = board.contents[i*_width+j];
+					mask |= (content == UNEXPLORED) << bit;
+					flagged += content == FLAGGED;
+				}
+				bit++;
+			}
+
+	int missing = std::min(std::max(number-flagged, 0), 8);
+	_codes[idx] = mask ? componentCode(missing, mask) : -1;
+	_numbers.set(idx, mask != 0);
+}
+
+inline int ProbabilityEngine::root(int number) {
+	while(_parent[number] != number)
+		number = _parent[number] = _parent[_parent[number]];
+	return number;
+}
+
+//groups the numbers sharing unexplored neighbours, and computes the key and
+//the hash of every group
+inline void ProbabilityEngine::findComponents(const Observation& board) {
+	_sorted.assign(_numbers.begin(), _numbers.end());
+	std::sort(_sorted.begin(), _sorted.end());
+
+	for (int number : _sorted)
+		_parent[number] = number;
+	for (int number : _sorted) {
+		int row = number/_width, col = number%_width;
+		for (int i = std::max(row-1, 0); i <= std::min(row+1, _height-1); i++)
+			for (int j = std::max(col-1, 0); j <= std::min(col+1, _width-1); j++) {
+				int n = i*_width+j;
+				if(board.contents[n] != UNEXPLORED)
+					continue;
+				if(_owner[n] < 0) {
+					_owner[n] = number;
+					_touched.push_back(n);
+				}
+				else
+					_parent[root(number)] = root(_owner[n]);
+			}
+	}
+
+	_component_count = 0;
+	for (int number : _sorted) {
+		int& c = _component_of[root(number)];
+		if(c < 0) {
+			c = _component_count++;
+			if((int)_components.size() < _component_count)
+				_components.emplace_back();
+			_components[c].numbers.clear();
+			_components[c].cells.clear();
+		}
+		_components[c].numbers.push_back(number);
+	}
+	for (int n : _touched) {
+		_components[_component_of[root(_owner[n])]].cells.push_back(n);
+		_owner[n] = -1;
+	}
+	for (int number : _sorted)
+		_component_of[number] = -1;
+	_touched.clear();
+
+	for (int c = 0; c < _component_count; c++) {
+		Component& component = _components[c];
+		std::sort(component.cells.begin(), component.cells.end());
+		int first_row = component.numbers[0]/_width, first_col = component.numbers[0]%_width;
+		component.key.clear();
+		component.hash = 0;
+		for (int number : component.numbers) {
+			int row = number/_width-first_row, col = number%_width-first_col;
+			component.key.push_back(componentKeyEntry(_codes[number], row, col));
+			component.hash ^= componentHash(ZOBRIST_KEYS.keys[_codes[number]], row, col);
+		}
+	}
+}
+
+//fills _problem with the numbers and the cells of the component
+inline void ProbabilityEngine::describe(const Component& component) {
+	int cells = (int)component.cells.size(), numbers = (int)component.numbers.size();
+	for (int i = 0; i < cells; i++)
+		_local[component.cells[i]] = i;
+	_problem.cells = cells;
+	_problem.numbers.resize(8*cells);
+	_problem.degree.assign(cells, 0);
+	_problem.missing.resize(numbers);
+	_problem.open.resize(numbers);
+	_problem.members.resize(8*numbers);
+
+	for (int k = 0; k < numbers; k++) {
+		int number = component.numbers[k], code = _codes[number];
+		int row = number/_width, col = number%_width, bit = 0, size = 0;
+		_problem.missing[k] = code/256;
+		_problem.open[k] = __builtin_popcount(code%256);
+		for (int i = row-1; i <= row+1; i++)
+			for (int j = col-1; j <= col+1; j++) {
+				if(i == row && j == col)
+					continue;
+				if(code >> bit & 1) {
+					int cell = _local[i*_width+j];
+					_problem.numbers[8*cell+_problem.degree[cell]++] = k;
+					_problem.members[8*k+size++] = cell;
+				}
+				bit++;
+			}
+	}
+	for (int cell : component.cells)
+		_local[cell] = -1;
+}
+
+//counts the placements of _problem, or returns nullptr if it is too large to
+//enumerate
+inline std::shared_ptr<const ComponentSolution> ProbabilityEngine::solve() {
+	int cells = _problem.cells;
+	if(cells > COMPONENT_MAX_CELLS)
+		return nullptr;
+
+	//cells around the same numbers are interchangeable: they are enumerated
+	//together, by how many of them are bombs. Such cells all are around the
+	//first of their numbers, so only its cells need to be compared
+	_group_of.assign(cells, -1);
+	_group_size.clear();
+	_group_first.clear();
+	for (int cell = 0; cell < cells; cell++) {
+		const int* numbers = &_problem.numbers[8*cell];
+		int degree = _problem.degree[cell], first = numbers[0];
+		for (int m = 0; m < _problem.open[first] && _group_of[cell] < 0; m++) {
+			int other = _problem.members[8*first+m];
+			if(other < cell && _problem.degree[other] == degree && std::equal(numbers, numbers+degree, &_problem.numbers[8*other]))
+				_group_of[cell] = _group_of[other];
+		}
+		if(_group_of[cell] < 0) {
+			_group_of[cell] = (int)_group_size.size();
+			_group_size.push_back(0);
+			_group_first.push_back(cell);
+		}
+		_group_size[_group_of[cell]]++;
+	}
+
+	int groups = (int)_group_size.size();
+	auto solution = std::make_shared<ComponentSolution>();
+	solution->cells = cells;
+	solution->ways.assign(cells+1, 0);
+	_group_bombs.assign((cells+1)*groups, 0);
+	_chosen.assign(groups, 0);
+	_steps = 0;
+	if(!enumerate(*solution, 0, 0, 1))
+		return nullptr;
+
+	//only the rows of the numbers of bombs some placement has are kept. The
+	//bombs of a group are spread evenly over its cells
+	int fewest = 0, most = cells;
+	while(fewest < most && solution->ways[fewest] == 0)
+		fewest++;
+	while(most > fewest && solution->ways[most] == 0)
+		most--;
+	solution->fewest = fewest;
+	solution->bombs.assign((most-fewest+1)*cells, 0);
+	for (int k = fewest; k <= most; k++)
+		for (int cell = 0; cell < cells; cell++) {
+			int group = _group_of[cell];
+			solution->bombs[(k-fewest)*cells+cell] = _group_bombs[k*groups+group]/_group_size[group];
+		}
+
+	double largest = *std::max_element(solution->ways.begin(), solution->ways.end());
+	solution->log_scale = largest > 0 ? std::log(largest) : 0;
+	if(largest > 0) {
+		for (double& ways : solution->ways)
+			ways /= largest;
+		for (double& bombs : solution->bombs)
+			bombs /= largest;
+	}
+	return solution;
+}
+
+//tries every number of bombs in group and in the groups after it, given
+//bombs bombs before it, placed in placements ways. Returns false once
+//COMPONENT_MAX_STEPS is reached
+inline bool ProbabilityEngine::enumerate(ComponentSolution& solution, int group, int bombs, double placements) {
+	//C(n, k) for the at most 8 cells of a group
+	static constexpr double CHOOSE[9][9] = {
+		{1}, {1, 1}, {1, 2, 1}, {1, 3, 3, 1}, {1, 4, 6, 4, 1}, {1, 5, 10, 10, 5, 1}, {1, 6, 15, 20, 15, 6, 1},
+		{1, 7, 21, 35, 35, 21, 7, 1}, {1, 8, 28, 56, 70, 56, 28, 8, 1}};
+	int groups = (int)_group_size.size();
+	if(++_steps > COMPONENT_MAX_STEPS)
+		return false;
+	if(group == groups) {
+		_steps += groups;
+		solution.ways[bombs] += placements;
+		double* counts = &_group_bombs[bombs*groups];
+		for (int g = 0; g < groups; g++)
+			counts[g] += placements*_chosen[g];
+		return true;
+	}
+
+	int size = _group_size[group], cell = _group_first[group];
+	const int* numbers = &_problem.numbers[8*cell];
+	int degree = _problem.degree[cell];
+	std::vector<int>& missing = _problem.missing;
+	std::vector<int>& open = _problem.open;
+	//the fewest and the most bombs the group can hold
+	int fewest = 0, most = size;
+	for (int k = 0; k < degree; k++) {
+		fewest = std::max(fewest, missing[numbers[k]]-(open[numbers[k]]-size));
+		most = std::min(most, missing[numbers[k]]);
+	}
+
+	for (int k = 0; k < degree; k++)
+		open[numbers[k]] -= size;
+	bool finished = true;
+	for (int value = fewest; value <= most && finished; value++) {
+		for (int k = 0; k < degree; k++)
+			missing[numbers[k]] -= value;
+		_chosen[group] = value;
+		finished = enumerate(solution, group+1, bombs+value, placements*CHOOSE[size][value]);
+		for (int k = 0; k < degree; k++)
+			missing[numbers[k]] += value;
+	}
+	for (int k = 0; k < degree; k++)
+		open[numbers[k]] += size;
+	return finished;
+}
+
+//weights the placements of every solved component by those of the others
+//and of the interior
+inline void ProbabilityEngine::combine(const Observation& board, std::vector<float>& probabilities) {
+	int cells = board.height*board.width, unexplored = 0, remaining = board.bomb_cnt;
+	probabilities.resize(cells);
+	for (int idx = 0; idx < cells; idx++) {
+		int content = board.contents[idx];
+		unexplored += content == UNEXPLORED;
+		remaining -= content == FLAGGED || content == BOMB;
+		probabilities[idx] = content == FLAGGED || content == BOMB;
+	}
+	_log_placements = remaining >= 0 && remaining <= unexplored ? 0 : -INFINITY;
+	if(unexplored == 0)
+		return;
+	remaining = std::min(std::max(remaining, 0), unexplored);
+
+	//the interior takes the cells of the unsolved components too
+	int interior = unexplored;
+	long cost = 0;
+	_solved.clear();
+	for (int c = 0; c < _component_count; c++)
+		if(_components[c].solution) {
+			_solved.push_back(&_components[c]);
+			interior -= _components[c].solution->cells;
+			cost += _components[c].solution->cells+1;
+		}
+	if(cost*(remaining+1) > PROBABILITY_EXACT_COMBINE) {
+		_log_placements = NAN;
+		combineByDensity(board, probabilities, remaining, interior);
+		return;
+	}
+
+	//_weight[K]: the placements of the interior when the components hold K
+	//bombs, C(interior, remaining-K), relative to the first possible K
+	_weight.assign(remaining+1, 0);
+	int fewest = std::max(remaining-interior, 0);
+	double log_weight = 0, largest = 0;
+	for (int K = fewest; K <= remaining; K++) {
+		if(K > fewest)
+			log_weight += std::log(double(remaining-K+1)/(interior-remaining+K));
+		_weight[K] = log_weight;
+		largest = std::max(largest, log_weight);
+	}
+	for (int K = fewest; K <= remaining; K++)
+		_weight[K] = std::exp(_weight[K]-largest);
+	//the scales dropped on the way add up to the log of the placements:
+	//here C(interior, remaining-fewest) and largest
+	int chosen = std::min(remaining-fewest, interior-remaining+fewest);
+	double log_scale = largest;
+	for (int i = 1; i <= chosen; i++)
+		log_scale += std::log(double(interior-chosen+i)/i);
+
+	//every vector below is scaled to its largest element as it is computed:
+	//the probabilities of a component are ratios of sums over the same vector
+	auto normalize = [](std::vector<double>& values) {
+		double most = values.empty() ? 0 : *std::max_element(values.begin(), values.end());
+		if(most > 0)
+			for (double& value : values)
+				value /= most;
+		return most;
+	};
+
+	//_prefix[i][K]: the placements of the first i components with K bombs
+	int count = (int)_solved.size();
+	_prefix.resize(count+1);
+	_prefix[0].assign(1, 1);
+	for (int i = 0; i < count; i++) {
+		const std::vector<double>& counts = _prefix[i];
+		const std::vector<double>& ways = _solved[i]->solution->ways;
+		std::vector<double>& out = _prefix[i+1];
+		out.assign(std::min((int)(counts.size()+ways.size())-1, remaining+1), 0);
+		for (int a = 0; a < (int)counts.size(); a++)
+			for (int b = 0; b < (int)ways.size() && a+b < (int)out.size(); b++)
+				out[a+b] += counts[a]*ways[b];
+		log_scale += _solved[i]->solution->log_scale+std::log(normalize(out));
+	}
+
+	//the interior and the unsolved components share evenly the bombs the
+	//solved components leave
+	double total = 0, expected = 0;
+	const std::vector<double>& all = _prefix[count];
+	for (int K = 0; K < (int)all.size(); K++) {
+		total += all[K]*_weight[K];
+		expected += all[K]*_weight[K]*(remaining-K);
+	}
+	_log_placements += log_scale+std::log(total);
+	float inside = interior > 0 && total > 0 ? float(expected/total/interior) : float(remaining)/unexplored;
+	for (int idx = 0; idx < cells; idx++)
+		if(board.contents[idx] == UNEXPLORED)
+			probabilities[idx] = inside;
+
+	//from the last component back, _tail[K]: the placements of the
+	//components after i and of the interior, given K bombs in the others.
+	//Component i with k bombs then weighs the sum over a of _prefix[i][a]
+	//times _tail[k+a]
+	_tail = _weight;
+	for (int i = count-1; i >= 0; i--) {
+		const ComponentSolution& solution = *_solved[i]->solution;
+		const std::vector<double>& before = _prefix[i];
+		_factor.assign(solution.cells+1, 0);
+		for (int k = 0; k <= solution.cells && k <= remaining; k++)
+			for (int a = 0; a < (int)before.size() && k+a <= remaining; a++)
+				_factor[k] += before[a]*_tail[k+a];
+		spread(*_solved[i], _factor, inside, probabilities);
+
+		_next.assign(remaining+1, 0);
+		for (int K = 0; K <= remaining; K++)
+			for (int k = 0; k <= solution.cells && K+k <= remaining; k++)
+				_next[K] += solution.ways[k]*_tail[K+k];
+		normalize(_next);
+		_tail.swap(_next);
+	}
+}
+
+//the probabilities of the cells of a solved component, its placements with
+//k bombs weighing factor[k]
+inline void ProbabilityEngine::spread(const Component& component, const std::vector<double>& factor, float fallback, std::vector<float>& probabilities) {
+	const ComponentSolution& solution = *component.solution;
+	int rows = (int)solution.bombs.size()/solution.cells;
+	double placements = 0;
+	for (int k = 0; k <= solution.cells; k++)
+		placements += solution.ways[k]*factor[k];
+	for (int j = 0; j < solution.cells; j++) {
+		double bombs = 0;
+		for (int row = 0; row < rows; row++)
+			bombs += solution.bombs[row*solution.cells+j]*factor[solution.fewest+row];
+		probabilities[component.cells[j]] = placements > 0 ? float(bombs/placements) : fallback;
+	}
+}
+
+//combine() for boards too large to weigh the components exactly: every bomb
+//is taken to be there with the same odds, ratio, independently of the total,
+//so a component with k bombs weighs ratio^k. ratio is the one for which the
+//bombs expected in the components and the interior add up to remaining. On
+//a board that large the difference is negligible
+inline void ProbabilityEngine::combineByDensity(const Observation& board, std::vector<float>& probabilities, int remaining, int interior) {
+	//_log_ways: the log of the placements of every component per number of
+	//bombs, one after the other
+	_log_ways.clear();
+	for (const Component* component : _solved)
+		for (double ways : component->solution->ways)
+			_log_ways.push_back(ways > 0 ? std::log(ways) : -INFINITY);
+
+	//factor[k] for the component whose logs start at first: ratio^k, scaled
+	//so that the largest placements times factor is 1
+	auto tilt = [&](const ComponentSolution& solution, const double* logs, double log_ratio, std::vector<double>& factor) {
+		factor.assign(solution.cells+1, 0);
+		double largest = -INFINITY;
+		for (int k = 0; k <= solution.cells; k++)
+			largest = std::max(largest, logs[k]+k*log_ratio);
+		for (int k = 0; k <= solution.cells; k++)
+			factor[k] = solution.ways[k] > 0 ? std::exp(k*log_ratio-largest) : 0;
+	};
+	auto expected = [&](double log_ratio) {
+		double bombs = interior/(1+std::exp(-log_ratio));
+		const double* logs = _log_ways.data();
+		for (const Component* component : _solved) {
+			const ComponentSolution& solution = *component->solution;
+			tilt(solution, logs, log_ratio, _factor);
+			logs += solution.cells+1;
+			double placements = 0, weighted = 0;
+			for (int k = 0; k <= solution.cells; k++) {
+				placements += solution.ways[k]*_factor[k];
+				weighted += k*solution.ways[k]*_factor[k];
+			}
+			bombs += placements > 0 ? weighted/placements : 0;
+		}
+		return bombs;
+	};
+
+	//the expected bombs grow with the ratio
+	double low = -PROBABILITY_LOG_RATIO_MAX, high = PROBABILITY_LOG_RATIO_MAX;
+	for (int step = 0; step < PROBABILITY_RATIO_STEPS; step++) {
+		double middle = (low+high)/2;
+		(expected(middle) < remaining ? low : high) = middle;
+	}
+	double log_ratio = (low+high)/2;
+
+	float inside = float(1/(1+std::exp(-log_ratio)));
+	for (int idx = 0; idx < board.height*board.width; idx++)
+		if(board.contents[idx] == UNEXPLORED)
+			probabilities[idx] = inside;
+	const double* logs = _log_ways.data();
+	for (const Component* component : _solved) {
+		tilt(*component->solution, logs, log_ratio, _factor);
+		logs += component->solution->cells+1;
+		spread(*component, _factor, inside, probabilities);
+	}
+}
+
+
+/*************************************************************************
+ProbabilitySolver
+*************************************************************************/
+
+inline void ProbabilitySolver::newGame(int height, int width, int bomb_cnt) {
+	EliminationSolver::newGame(height, width, bomb_cnt);
+	_engine.reset(height, width);
+}
+
+inline Action ProbabilitySolver::guess(const Observation& board) {
+	_engine.compute(board, _probabilities);
+	return safest(board);
+}
+
+//the cell least likely to be a bomb according to _probabilities
+inline Action ProbabilitySolver::safest(const Observation& board) {
+	float best = 2;
+	_candidates.clear();
+	for (int idx = 0; idx < board.height*board.width; idx++) {
+		if(board.contents[idx] != UNEXPLORED || _probabilities[idx] > best+1e-6f)
+			continue;
+		if(_probabilities[idx] < best-1e-6f) {
+			best = _probabilities[idx];
+			_candidates.clear();
+		}
+		_candidates.push_back(idx);
+	}
+
+	if(_candidates.empty())
+		return {-1, -1, LEFT};
+	int idx = _candidates[_random()%_candidates.size()];
+	return {idx/board.width, idx%board.width, LEFT};
+}
@@ -0,0 +1,184 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "def.h"
+
+/*
+classes Profiler and ScopedTimer are defined in this file
+
+PROFILE_SCOPE("name") times the enclosing block. Timings are kept per thread
+and can be written as Chrome trace-event JSON (open with about:tracing or
+ui.perfetto.dev). The render loop also reports frame boundaries, which Gui
+draws as a frame-time graph.
+
+Instrumentation only exists when the project is configured with
+-DMINESWEEPER_PROFILE=ON. Otherwise PROFILE_SCOPE expands to nothing and costs
+nothing. When compiled in, it still does nothing until Profiler::enable() is
+called, apart from one relaxed atomic load per scope.
+
+	events --> every thread appends completed scopes to its own buffer, so
+				recording never contends with other threads. A buffer stops
+				growing after MAX_EVENTS_PER_THREAD events.
+
+	frames --> the last FRAME_HISTORY frame durations, as a ring buffer
+				written by the render thread.
+*/
+#define MAX_EVENTS_PER_THREAD (1 << 20)
+#define FRAME_HISTORY 240
+
+#ifdef MINESWEEPER_PROFILE
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#define PROFILE_SCOPE(name) ScopedTimer PROFILE_CONCAT(_profile_scope_, __LINE__)(name)
+#else
+#define PROFILE_SCOPE(name) ((void)0)
+#endif
+
+struct ProfileEvent {
+	const char* name;
+	int64_t start_ns, duration_ns;
+};
+
+class Profiler
+{
+public:
+	static Profiler& instance();
+
+	void enable(bool on);
+	bool enabled() const;
+
+	void record(const char* name, Clock::time_point start, Clock::time_point end);
+	void frame();
+	float frameTime(int age) const;
+
+	void writeChromeTrace(std::ostream& out);
+
+private:
+	struct ThreadBuffer {
+		std::mutex mutex;
+		std::vector<ProfileEvent> events;
+		int tid;
+	};
+
+	Profiler();
+	ThreadBuffer& threadBuffer();
+
+	std::atomic<bool> _enabled;
+	Clock::time_point _epoch;
+
+	std::mutex _threads_mutex;
+	std::vector<std::unique_ptr<ThreadBuffer>> _threads;
+
+	Clock::time_point _last_frame;
+	float _frames_ms[FRAME_HISTORY];
+	int _frame_cnt;
+};
+
+//times its own lifetime. Created through PROFILE_SCOPE
+class ScopedTimer
+{
+public:
+	ScopedTimer(const char* name);
+	~ScopedTimer();
+
+private:
+	const char* _name;
+	bool _active;
+	Clock::time_point _start;
+};
+
+
+inline Profiler::Profiler() : _enabled(false), _epoch(Clock::now()), _frames_ms(), _frame_cnt(0) {}
+
+inline Profiler& Profiler::instance() {
+	static Profiler profiler;
+	return profiler;
+}
+
+inline void Profiler::enable(bool on) {
+	_enabled.store(on, std::memory_order_relaxed);
+}
+
+inline bool Profiler::enabled() const {
+	return _enabled.load(std::memory_order_relaxed);
+}
+
+//each thread registers its buffer on first use. The profiler owns the
+//buffers, so their events outlive the threads that recorded them
+inline Profiler::ThreadBuffer& Profiler::threadBuffer() {
+	static thread_local ThreadBuffer* buffer = nullptr;
+	if(!buffer) {
+		std::lock_guard<std::mutex> lock(_threads_mutex);
+		_threads.emplace_back(new ThreadBuffer());
+		buffer = _threads.back().get();
+		buffer->tid = (int)_threads.size();
+	}
+	return *buffer;
+}
+
+inline void Profiler::record(const char* name, Clock::time_point start, Clock::time_point end) {
+	ThreadBuffer& buffer = threadBuffer();
+	std::lock_guard<std::mutex> lock(buffer.mutex);
+	if(buffer.events.size() >= MAX_EVENTS_PER_THREAD)
+		return;
+
+	buffer.events.push_back({name,
+		std::chrono::duration_cast<std::chrono::nanoseconds>(start - _epoch).count(),
+		std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count()});
+}
+
+//marks the end of a rendered frame. Only called from the render thread
+inline void Profiler::frame() {
+	Clock::time_point now = Clock::now();
+	if(_last_frame != Clock::time_point())
+		_frames_ms[_frame_cnt++ % FRAME_HISTORY] = std::chrono::duration<float, std::milli>(now - _last_frame).count();
+	_last_frame = now;
+}
+
+//duration in ms of the frame rendered age frames ago, 0 if there is none
+inline float Profiler::frameTime(int age) const {
+	if(age >= FRAME_HISTORY || age >= _frame_cnt)
+		return 0;
+	return _frames_ms[(_frame_cnt-1-age) % FRAME_HISTORY];
+}
+
+//complete ("X") events, one trace row per recording thread
+inline void Profiler::writeChromeTrace(std::ostream& out) {
+	std::lock_guard<std::mutex> threads_lock(_threads_mutex);
+	std::ios::fmtflags flags = out.flags();
+	std::streamsize precision = out.precision();
+	bool first = true;
+
+	out << std::fixed << std::setprecision(3);
+	out << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+	for (auto& buffer : _threads) {
+		std::lock_guard<std::mutex> lock(buffer->mutex);
+		for (const ProfileEvent& e : buffer->events) {
+			out << (first ? "" : ",\n")
+				<< "{\"name\": \"" << e.name << "\", \"ph\": \"X\", \"pid\": 1, \"tid\": " << buffer->tid
+				<< ", \"ts\": " << e.start_ns/1000.0 << ", \"dur\": " << e.duration_ns/1000.0 << "}";
+			first = false;
+		}
+	}
+	out << "\n]}\n";
+	out.flags(flags);
+	out.precision(precision);
+}
+
+inline ScopedTimer::ScopedTimer(const char* name) : _name(name), _active(Profiler::instance().enabled()) {
+	if(_active)
+		_start = Clock::now();
+}
+
+inline ScopedTimer::~ScopedTimer() {
+	if(_active)
+		Profiler::instance().record(_name, _start, Clock::now());
+}
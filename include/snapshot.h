@@ -0,0 +1,84 @@
+#pragma once
+
+#include <atomic>
+
+/*
+class TripleBuffer is defined in this file
+
+TripleBuffer hands complete copies of some state from one producer thread to
+one consumer thread without either side ever waiting for the other. It is used
+to pass board snapshots from the logic thread to the render thread.
+
+	back --> the slot the producer is currently writing. Once the copy is
+				complete, publish() exchanges it with the middle slot.
+
+	middle --> the most recently published slot. It is never touched by
+				either side, only exchanged atomically.
+
+	front --> the slot the consumer is currently reading. acquire() exchanges
+				it with the middle slot, but only when something new has been
+				published since the last call.
+
+The three slot indices and a "fresh" bit are packed in a single atomic, so a
+publish or an acquire is a single compare-and-swap. The consumer always gets
+the latest complete state and the producer never blocks on a slow frame.
+*/
+template <typename T>
+class TripleBuffer
+{
+public:
+	TripleBuffer();
+
+	T& back();
+	void publish();
+
+	const T& acquire(bool* fresh = nullptr);
+
+private:
+	static const int FRESH = 1 << 6;
+
+	static int back(int state) { return state & 3; }
+	static int middle(int state) { return (state >> 2) & 3; }
+	static int front(int state) { return (state >> 4) & 3; }
+	static int pack(int b, int m, int f, bool fresh) { return b | (m << 2) | (f << 4) | (fresh ? FRESH : 0); }
+
+	T _slots[3];
+	std::atomic<int> _state;
+};
+
+
+template <typename T>
+TripleBuffer<T>::TripleBuffer() : _state(pack(0, 1, 2, false)) {}
+
+//slot owned by the producer. Only the producer thread may call this
+template <typename T>
+T& TripleBuffer<T>::back() {
+	return _slots[back(_state.load(std::memory_order_relaxed))];
+}
+
+//makes the back slot visible to the consumer and takes over the old middle
+//slot as the new back slot
+template <typename T>
+void TripleBuffer<T>::publish() {
+	int state = _state.load(std::memory_order_relaxed);
+	while(!_state.compare_exchange_weak(state,
+			pack(middle(state), back(state), front(state), true),
+			std::memory_order_acq_rel, std::memory_order_relaxed));
+}
+
+//returns the latest published slot. If nothing has been published since the
+//last call, the same slot is returned again and fresh is set to false
+template <typename T>
+const T& TripleBuffer<T>::acquire(bool* fresh) {
+	int state = _state.load(std::memory_order_acquire);
+	bool updated = (state & FRESH) != 0;
+
+	if(updated)
+		while(!_state.compare_exchange_weak(state,
+				pack(back(state), front(state), middle(state), false),
+				std::memory_order_acq_rel, std::memory_order_acquire));
+
+	if(fresh)
+		*fresh = updated;
+	return _slots[front(_state.load(std::memory_order_relaxed))];
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include "def.h"
+#include "frontier.h"
+
+/*
+class Solver is defined in this file
+
+A Solver is a strategy that plays minesweeper on its own. It only ever sees
+what a player would see, an Observation, and answers with the next Action.
+Everything that plays without a mouse goes through this interface: the
+automatic player of Board::run, the tournament (tools/) and solvers loaded
+from shared libraries (see solver_plugin.h).
+
+	newGame --> called before the first move of every game, with the size
+				and bomb count of the board.
+
+	nextMove --> called once per move with the current state of the board.
+				A move that changes nothing (exploring an explored cell, an
+				impossible chord...) is still counted as a move.
+
+A Solver is used by one thread at a time. Code playing several games at once
+creates one instance per thread from the registry below.
+*/
+
+//what a solver gets to see of a board: the getContent() value of every cell,
+//row by row (see observation.h). When the caller tracks them, frontier and
+//constraints point at the sets of frontier.h, whose members are indices in
+//the padded storage of the board (use row() and col()); otherwise they are
+//nullptr and the solver has to find them itself
+struct Observation {
+	const int8_t* contents;
+	int height, width, bomb_cnt;
+	const IndexedSet* frontier;
+	const IndexedSet* constraints;
+
+	int at(int row, int col) const { return contents[row*width+col]; }
+	int row(int idx) const { return idx/(width+2)-1; }
+	int col(int idx) const { return idx%(width+2)-1; }
+};
+
+class Solver
+{
+public:
+	virtual ~Solver() {}
+
+	virtual const char* name() const = 0;
+	virtual void newGame(int height, int width, int bomb_cnt) {}
+	virtual Action nextMove(const Observation& board) = 0;
+};
+
+//makes a new instance of a solver. seed is for strategies that guess, so a
+//run can be reproduced
+typedef std::function<std::unique_ptr<Solver>(unsigned seed)> SolverFactory;
+
+struct SolverEntry {
+	std::string name;
+	SolverFactory create;
+};
+
+//every strategy known to this program, in registration order
+inline std::vector<SolverEntry>& solverRegistry() {
+	static std::vector<SolverEntry> registry;
+	return registry;
+}
+
+inline void registerSolver(const std::string& name, SolverFactory create) {
+	solverRegistry().push_back({name, create});
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <dlfcn.h>
+#include <iostream>
+#include <memory>
+#include "def.h"
+#include "solver.h"
+#include "minesweeper_solver.h"
+
+/*
+class PluginSolver is defined in this file
+
+PluginSolver is a Solver played by a shared library that implements the C
+interface of minesweeper_solver.h. loadSolverPlugin opens the library and
+adds it to the solver registry under the name it gives itself; every
+instance made from the registry entry then shares the library, which is
+closed once the last of them is gone.
+*/
+class PluginSolver : public Solver
+{
+public:
+	PluginSolver(std::shared_ptr<void> library, const minesweeper_solver_plugin* api, unsigned seed);
+	~PluginSolver();
+	PluginSolver(const PluginSolver&) = delete;
+	PluginSolver& operator=(const PluginSolver&) = delete;
+
+	const char* name() const override { return _api->name; }
+	void newGame(int height, int width, int bomb_cnt) override;
+	Action nextMove(const Observation& board) override;
+
+private:
+	std::shared_ptr<void> _library;
+	const minesweeper_solver_plugin* _api;
+	void* _solver;
+};
+
+static_assert(MINESWEEPER_BOMB == BOMB && MINESWEEPER_UNEXPLORED == UNEXPLORED && MINESWEEPER_FLAGGED == FLAGGED, "C contents out of step with Visibility");
+
+
+inline PluginSolver::PluginSolver(std::shared_ptr<void> library, const minesweeper_solver_plugin* api, unsigned seed) : _library(library),
+																												_api(api),
+																												_solver(api->create(seed)) {}
+
+inline PluginSolver::~PluginSolver() {
+	_api->destroy(_solver);
+}
+
+inline void PluginSolver::newGame(int height, int width, int bomb_cnt) {
+	if(_api->new_game)
+		_api->new_game(_solver, height, width, bomb_cnt);
+}
+
+inline Action PluginSolver::nextMove(const Observation& board) {
+	minesweeper_action action = _api->next_move(_solver, board.contents, board.height, board.width, board.bomb_cnt);
+	return {action.row, action.col, (MouseButton)action.button};
+}
+
+//opens the plugin at path and registers it. Returns false, after saying why
+//on std::cerr, if it cannot be used
+inline bool loadSolverPlugin(const char* path) {
+	void* handle = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+	if(!handle) {
+		std::cerr << "cannot load solver plugin: " << dlerror() << std::endl;
+		return false;
+	}
+	std::shared_ptr<void> library(handle, [](void* h) { dlclose(h); });
+
+	typedef const minesweeper_solver_plugin* (*Entry)();
+	Entry entry = reinterpret_cast<Entry>(dlsym(handle, MINESWEEPER_SOLVER_ENTRY));
+	const minesweeper_solver_plugin* api = entry ? entry() : nullptr;
+
+	if(!api || api->abi_version != MINESWEEPER_SOLVER_ABI || !api->name || !api->create || !api->destroy || !api->next_move) {
+		std::cerr << path << ": not a solver plugin for ABI version " << MINESWEEPER_SOLVER_ABI << std::endl;
+		return false;
+	}
+
+	registerSolver(api->name, [=](unsigned seed) { return std::unique_ptr<Solver>(new PluginSolver(library, api, seed)); });
+	return true;
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <vector>
+#include <GLFW/glfw3.h>
+
+/*
+class VertexBatch is defined in this file
+
+VertexBatch collects the geometry of a whole frame on the CPU and hands it to
+OpenGL in two draw calls (one for triangles, one for lines), instead of one
+glBegin/glEnd pair per shape. Shapes are described with the same
+begin/color/vertex/end sequence as immediate mode, and are converted as they
+are closed:
+
+	GL_TRIANGLES --> kept as is.
+	GL_QUADS --> every 4 vertices become 2 triangles.
+	GL_POLYGON --> triangulated as a fan (all our polygons are convex).
+	GL_LINES --> kept as is, in the line list.
+
+Building the batch needs no GL context, so it can run offscreen.
+*/
+struct Vertex {
+	float x, y;
+	float r, g, b;
+};
+
+class VertexBatch
+{
+public:
+	VertexBatch();
+
+	void clear();
+	void color(float r, float g, float b);
+	void begin(GLenum mode);
+	void vertex(float x, float y);
+	void end();
+
+	void submit() const;
+	size_t size() const;
+
+	std::vector<Vertex> _triangles, _lines;
+
+private:
+	GLenum _mode;
+	float _r, _g, _b;
+	std::vector<Vertex> _shape;
+};
+
+
+inline VertexBatch::VertexBatch() : _mode(GL_TRIANGLES), _r(1), _g(1), _b(1) {}
+
+//forgets the geometry but keeps the memory for the next frame
+inline void VertexBatch::clear() {
+	_triangles.clear();
+	_lines.clear();
+}
+
+inline void VertexBatch::color(float r, float g, float b) {
+	_r = r; _g = g; _b = b;
+}
+
+inline void VertexBatch::begin(GLenum mode) {
+	_mode = mode;
+	_shape.clear();
+}
+
+inline void VertexBatch::vertex(float x, float y) {
+	_shape.push_back({x, y, _r, _g, _b});
+}
+
+inline void VertexBatch::end() {
+	size_t n = _shape.size();
+
+	if(_mode == GL_TRIANGLES)
+		_triangles.insert(_triangles.end(), _shape.begin(), _shape.begin()+n/3*3);
+	else if(_mode == GL_LINES)
+		_lines.insert(_lines.end(), _shape.begin(), _shape.begin()+n/2*2);
+	else if(_mode == GL_QUADS)
+		for (size_t i = 0; i+3 < n; i += 4) {
+			_triangles.push_back(_shape[i]);
+			_triangles.push_back(_shape[i+1]);
+			_triangles.push_back(_shape[i+2]);
+			_triangles.push_back(_shape[i]);
+			_triangles.push_back(_shape[i+2]);
+			_triangles.push_back(_shape[i+3]);
+		}
+	else if(_mode == GL_POLYGON)
+		for (size_t i = 1; i+1 < n; i++) {
+			_triangles.push_back(_shape[0]);
+			_triangles.push_back(_shape[i]);
+			_triangles.push_back(_shape[i+1]);
+		}
+
+	_shape.clear();
+}
+
+//draws everything collected since the last clear. Lines go last so cell
+//borders stay on top of the squares they outline
+inline void VertexBatch::submit() const {
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glEnableClientState(GL_COLOR_ARRAY);
+
+	if(!_triangles.empty()) {
+		glVertexPointer(2, GL_FLOAT, sizeof(Vertex), &_triangles[0].x);
+		glColorPointer(3, GL_FLOAT, sizeof(Vertex), &_triangles[0].r);
+		glDrawArrays(GL_TRIANGLES, 0, (GLsizei)_triangles.size());
+	}
+	if(!_lines.empty()) {
+		glVertexPointer(2, GL_FLOAT, sizeof(Vertex), &_lines[0].x);
+		glColorPointer(3, GL_FLOAT, sizeof(Vertex), &_lines[0].r);
+		glDrawArrays(GL_LINES, 0, (GLsizei)_lines.size());
+	}
+
+	glDisableClientState(GL_COLOR_ARRAY);
+	glDisableClientState(GL_VERTEX_ARRAY);
+}
+
+//number of vertices in the batch
+inline size_t VertexBatch::size() const {
+	return _triangles.size()+_lines.size();
+}
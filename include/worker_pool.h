@@ -0,0 +1,107 @@
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+class WorkerPool is defined in this file
+
+The searches behind a solver's guess (see lookahead_solver.h and
+endgame_solver.h) split their work over threads within a budget of a few
+tens of milliseconds, once per move. Starting and joining that many threads
+on every move would eat into the budget, so WorkerPool starts them once and
+keeps them waiting:
+
+	run --> calls work(t) for every t below the number of threads asked
+				for, t = 0 on the calling thread and the others on the
+				waiting threads, and returns once every call has returned.
+				Threads the run does not need keep waiting.
+
+A pool of n threads starts n-1 of them, the caller being the last one. It
+runs one call to run() at a time.
+*/
+class WorkerPool
+{
+public:
+	explicit WorkerPool(int threads);
+	~WorkerPool();
+
+	WorkerPool(const WorkerPool&) = delete;
+	WorkerPool& operator=(const WorkerPool&) = delete;
+
+	int size() const { return (int)_threads.size()+1; }
+	void run(int threads, const std::function<void(int)>& work);
+
+private:
+	void wait(int t);
+
+	std::vector<std::thread> _threads;
+	std::mutex _mutex;
+	std::condition_variable _start;
+	std::condition_variable _done;
+	const std::function<void(int)>* _work;
+	//the threads of the current run, and those of them still working
+	int _running, _busy;
+	unsigned _run;
+	bool _stopped;
+};
+
+
+inline WorkerPool::WorkerPool(int threads) : _work(nullptr), _running(0), _busy(0), _run(0), _stopped(false) {
+	for (int t = 1; t < threads; t++)
+		_threads.emplace_back(&WorkerPool::wait, this, t);
+}
+
+inline WorkerPool::~WorkerPool() {
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_stopped = true;
+	}
+	_start.notify_all();
+	for (std::thread& thread : _threads)
+		thread.join();
+}
+
+//threads is capped to the size of the pool
+inline void WorkerPool::run(int threads, const std::function<void(int)>& work) {
+	threads = std::min(std::max(threads, 1), size());
+	if(threads > 1) {
+		std::lock_guard<std::mutex> lock(_mutex);
+		_work = &work;
+		_running = threads;
+		_busy = threads-1;
+		_run++;
+		_start.notify_all();
+	}
+	work(0);
+	if(threads > 1) {
+		std::unique_lock<std::mutex> lock(_mutex);
+		_done.wait(lock, [this] { return _busy == 0; });
+		_work = nullptr;
+	}
+}
+
+//the loop of the thread t, waiting for the runs that need it
+inline void WorkerPool::wait(int t) {
+	unsigned seen = 0;
+	std::unique_lock<std::mutex> lock(_mutex);
+	while(true) {
+		_start.wait(lock, [&] { return _stopped || _run != seen; });
+		if(_stopped)
+			return;
+		seen = _run;
+		if(t >= _running)
+			continue;
+
+		const std::function<void(int)>& work = *_work;
+		lock.unlock();
+		work(t);
+		lock.lock();
+		if(--_busy == 0)
+			_done.notify_one();
+	}
+}
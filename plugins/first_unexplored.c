@@ -0,0 +1,38 @@
+#include <stdlib.h>
+#include "minesweeper_solver.h"
+
+/*
+Example solver plugin: explores the first unexplored cell in reading order.
+It shows the whole plugin interface and gives the tournament a second
+baseline next to the random solver.
+
+	minesweeper_tournament --plugin ./libfirst_unexplored.so
+*/
+
+static void* create(unsigned seed) {
+	(void)seed;
+	return malloc(1);
+}
+
+static void destroy(void* solver) {
+	free(solver);
+}
+
+static minesweeper_action next_move(void* solver, const int8_t* contents, int height, int width, int bombs) {
+	minesweeper_action action = {-1, -1, MINESWEEPER_EXPLORE};
+	(void)solver;
+	(void)bombs;
+
+	for (int idx = 0; idx < height*width; idx++)
+		if(contents[idx] == MINESWEEPER_UNEXPLORED) {
+			action.row = idx/width;
+			action.col = idx%width;
+			break;
+		}
+	return action;
+}
+
+const minesweeper_solver_plugin* minesweeper_get_solver(void) {
+	static const minesweeper_solver_plugin plugin = {MINESWEEPER_SOLVER_ABI, "first-unexplored", create, destroy, NULL, next_move};
+	return &plugin;
+}
@@ -0,0 +1,166 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "board_state.h"
+#include "board_analysis.h"
+
+/*
+minesweeper_analyze grades seeded boards without playing them (see
+board_analysis.h) and keeps those within the given bounds.
+
+	minesweeper_analyze [--boards N] [--seed S] [--board SIZE] [--threads T]
+	                    [--min-3bv N] [--max-3bv N] [--max-guessing F]
+	                    [--csv FILE]
+
+SIZE is beginner, intermediate, expert (the default) or HEIGHTxWIDTHxBOMBS.
+The seeds of the boards come from S the way the tournament's do, so a kept
+board is replayed with BoardState(height, width, bombs, seed). Boards are
+graded ANALYZE_BATCH at a time, spread over T threads (all cores by default)
+in chunks of ANALYZE_CHUNK, and the kept ones are written to the CSV file
+(- for the standard output) in seed order, one line per board:
+seed,3bv,openings,islands,guessing. The report gives the throughput, the
+average of every metric over all the boards and the range of their 3BV.
+*/
+#define ANALYZE_BATCH (1 << 16)
+#define ANALYZE_CHUNK 256
+
+struct Bounds {
+	int min_bbbv, max_bbbv;
+	float max_guessing;
+
+	bool keep(const BoardMetrics& metrics) const {
+		return metrics.bbbv >= min_bbbv && metrics.bbbv <= max_bbbv && metrics.guessing <= max_guessing;
+	}
+};
+
+//totals over all the boards graded
+struct Summary {
+	long boards, kept, guess_free;
+	double bbbv, openings, islands, guessing;
+	int min_bbbv, max_bbbv;
+};
+
+static bool parseBoard(const char* text, int& height, int& width, int& bombs) {
+	if(!std::strcmp(text, "beginner"))
+		height = 9, width = 9, bombs = BEGINNER_BOMBS;
+	else if(!std::strcmp(text, "intermediate"))
+		height = 16, width = 16, bombs = INTERMEDIATE_BOMBS;
+	else if(!std::strcmp(text, "expert"))
+		height = 16, width = 30, bombs = EXPERT_BOMBS;
+	else if(std::sscanf(text, "%dx%dx%d", &height, &width, &bombs) != 3)
+		return false;
+	return height > 0 && width > 0 && bombs >= 0 && bombs < height*width;
+}
+
+int main(int argc, char** argv) {
+	long boards = 100000;
+	int threads = std::thread::hardware_concurrency();
+	int height = 16, width = 30, bombs = EXPERT_BOMBS;
+	unsigned seed = 1;
+	Bounds bounds = {0, 1 << 30, 1};
+	const char* csv = nullptr;
+
+	for (int i = 1; i < argc; i++) {
+		if(!std::strcmp(argv[i], "--boards") && i+1 < argc)
+			boards = std::atol(argv[++i]);
+		else if(!std::strcmp(argv[i], "--seed") && i+1 < argc)
+			seed = std::strtoul(argv[++i], nullptr, 10);
+		else if(!std::strcmp(argv[i], "--board") && i+1 < argc && parseBoard(argv[i+1], height, width, bombs))
+			i++;
+		else if(!std::strcmp(argv[i], "--threads") && i+1 < argc)
+			threads = std::atoi(argv[++i]);
+		else if(!std::strcmp(argv[i], "--min-3bv") && i+1 < argc)
+			bounds.min_bbbv = std::atoi(argv[++i]);
+		else if(!std::strcmp(argv[i], "--max-3bv") && i+1 < argc)
+			bounds.max_bbbv = std::atoi(argv[++i]);
+		else if(!std::strcmp(argv[i], "--max-guessing") && i+1 < argc)
+			bounds.max_guessing = std::atof(argv[++i]);
+		else if(!std::strcmp(argv[i], "--csv") && i+1 < argc)
+			csv = argv[++i];
+		else {
+			std::cerr << "usage: " << argv[0] << " [--boards N] [--seed S] [--board beginner|intermediate|expert|HxWxB] [--threads T]"
+					  << " [--min-3bv N] [--max-3bv N] [--max-guessing F] [--csv FILE]" << std::endl;
+			return 2;
+		}
+	}
+	if(boards <= 0) {
+		std::cerr << "nothing to analyze" << std::endl;
+		return 2;
+	}
+	threads = threads < 1 ? 1 : threads;
+
+	std::ofstream file;
+	std::ostream* out = nullptr;
+	if(csv && !std::strcmp(csv, "-"))
+		out = &std::cout;
+	else if(csv) {
+		file.open(csv);
+		out = &file;
+	}
+	if(out)
+		*out << "seed,3bv,openings,islands,guessing\n";
+
+	//every thread keeps its analyzer from one batch to the next
+	std::vector<BoardAnalyzer<>> analyzers(threads, BoardAnalyzer<>(height, width));
+	std::vector<unsigned> seeds(ANALYZE_BATCH);
+	std::vector<BoardMetrics> metrics(ANALYZE_BATCH);
+	std::minstd_rand random(seed);
+	Summary summary = {0, 0, 0, 0, 0, 0, 0, 1 << 30, 0};
+	Clock::time_point start = Clock::now();
+
+	for (long first = 0; first < boards; first += ANALYZE_BATCH) {
+		int count = (int)std::min<long>(ANALYZE_BATCH, boards-first);
+		for (int b = 0; b < count; b++)
+			seeds[b] = random();
+
+		std::atomic<int> next(0);
+		auto work = [&](int t) {
+			BoardAnalyzer<>& analyzer = analyzers[t];
+			for (int chunk = next++; chunk*ANALYZE_CHUNK < count; chunk = next++)
+				for (int b = chunk*ANALYZE_CHUNK; b < std::min((chunk+1)*ANALYZE_CHUNK, count); b++)
+					metrics[b] = analyzer.generate(bombs, seeds[b]);
+		};
+		std::vector<std::thread> workers;
+		for (int t = 1; t < threads; t++)
+			workers.emplace_back(work, t);
+		work(0);
+		for (std::thread& worker : workers)
+			worker.join();
+
+		for (int b = 0; b < count; b++) {
+			const BoardMetrics& m = metrics[b];
+			summary.boards++;
+			summary.bbbv += m.bbbv;
+			summary.openings += m.openings;
+			summary.islands += m.islands;
+			summary.guessing += m.guessing;
+			summary.guess_free += m.guessing == 0;
+			summary.min_bbbv = std::min(summary.min_bbbv, m.bbbv);
+			summary.max_bbbv = std::max(summary.max_bbbv, m.bbbv);
+			if(!bounds.keep(m))
+				continue;
+			summary.kept++;
+			if(out)
+				*out << seeds[b] << ',' << m.bbbv << ',' << m.openings << ',' << m.islands << ',' << m.guessing << '\n';
+		}
+	}
+
+	double seconds = std::chrono::duration<double>(Clock::now()-start).count();
+	std::FILE* report = out == &std::cout ? stderr : stdout;
+	std::fprintf(report, "%ld boards of %dx%d with %d bombs, seed %u, in %.2f s (%.0f boards/min)\n\n", summary.boards, height, width, bombs,
+				 seed, seconds, summary.boards/seconds*60);
+	std::fprintf(report, "3bv        mean %8.2f  min %6d  max %6d\n", summary.bbbv/summary.boards, summary.min_bbbv, summary.max_bbbv);
+	std::fprintf(report, "openings   mean %8.2f\n", summary.openings/summary.boards);
+	std::fprintf(report, "islands    mean %8.2f\n", summary.islands/summary.boards);
+	std::fprintf(report, "guessing   mean %8.4f  guess-free %.2f%%\n", summary.guessing/summary.boards, 100.0*summary.guess_free/summary.boards);
+	std::fprintf(report, "kept       %ld (%.2f%%)\n", summary.kept, 100.0*summary.kept/summary.boards);
+	return 0;
+}
@@ -0,0 +1,193 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "board_state.h"
+#include "board_analysis.h"
+#include "board_corpus.h"
+#include "corpus_index.h"
+
+/*
+minesweeper_corpus builds and queries indexed corpora (see corpus_index.h).
+
+	minesweeper_corpus index OUT IN... [--threads T]
+	minesweeper_corpus query FILE [--board SIZE] [--min-3bv N] [--max-3bv N]
+	                   [--min-openings N] [--max-openings N] [--no-guess]
+	                   [--limit N]
+
+index grades every board of the corpora written by minesweeper_gen (see
+board_corpus.h), INDEX_BATCH at a time over T threads (all cores by
+default), and writes them with their grades to OUT, whatever their sizes.
+
+query lists the boards of SIZE (beginner, intermediate, expert, the default,
+or HEIGHTxWIDTHxBOMBS) within the bounds, as seed,3bv,openings,guess_free
+lines, at most N of them. The scan runs over the index of the 3BV, or over
+the one of the openings when only they are bounded, and the other bounds are
+checked on the boards of the range.
+*/
+#define INDEX_BATCH (1 << 16)
+#define INDEX_CHUNK 256
+
+static bool parseBoard(const char* text, int& height, int& width, int& bombs) {
+	if(!std::strcmp(text, "beginner"))
+		height = 9, width = 9, bombs = BEGINNER_BOMBS;
+	else if(!std::strcmp(text, "intermediate"))
+		height = 16, width = 16, bombs = INTERMEDIATE_BOMBS;
+	else if(!std::strcmp(text, "expert"))
+		height = 16, width = 30, bombs = EXPERT_BOMBS;
+	else if(std::sscanf(text, "%dx%dx%d", &height, &width, &bombs) != 3)
+		return false;
+	return height > 0 && width > 0 && bombs >= 0 && bombs < height*width;
+}
+
+static int usage(const char* name) {
+	std::cerr << "usage: " << name << " index OUT IN... [--threads T]\n"
+			  << "       " << name << " query FILE [--board beginner|intermediate|expert|HxWxB] [--min-3bv N] [--max-3bv N]"
+			  << " [--min-openings N] [--max-openings N] [--no-guess] [--limit N]" << std::endl;
+	return 2;
+}
+
+//what one thread needs to grade boards, kept from one batch to the next
+struct Grader {
+	Grid<> grid;
+	Grid<>::Array<Cell> layout;
+	BoardAnalyzer<> analyzer;
+
+	Grader(int height, int width) : grid(height, width), analyzer(height, width) {}
+};
+
+static int indexCorpora(int argc, char** argv) {
+	int threads = std::thread::hardware_concurrency();
+	std::vector<const char*> inputs;
+	for (int i = 3; i < argc; i++) {
+		if(!std::strcmp(argv[i], "--threads") && i+1 < argc)
+			threads = std::atoi(argv[++i]);
+		else
+			inputs.push_back(argv[i]);
+	}
+	if(inputs.empty())
+		return usage(argv[0]);
+	threads = threads < 1 ? 1 : threads;
+
+	CorpusIndexWriter writer;
+	if(!writer.open(argv[2])) {
+		std::cerr << "can't write " << argv[2] << std::endl;
+		return 1;
+	}
+	long boards = 0;
+	Clock::time_point start = Clock::now();
+
+	for (const char* input : inputs) {
+		CorpusReader reader;
+		if(!reader.open(input)) {
+			std::cerr << input << " is not a corpus" << std::endl;
+			return 1;
+		}
+		const CorpusHeader& header = reader.header();
+		std::vector<Grader> graders(threads, Grader(header.height, header.width));
+		std::vector<uint8_t> records((size_t)INDEX_BATCH*header.record_bytes);
+		std::vector<BoardMetrics> metrics(INDEX_BATCH);
+
+		while(true) {
+			int count = 0;
+			for (const uint8_t* record; count < INDEX_BATCH && (record = reader.next()); count++)
+				std::memcpy(records.data()+(size_t)count*header.record_bytes, record, header.record_bytes);
+			if(!count)
+				break;
+
+			std::atomic<int> next(0);
+			auto work = [&](int t) {
+				Grader& grader = graders[t];
+				for (int chunk = next++; chunk*INDEX_CHUNK < count; chunk = next++)
+					for (int b = chunk*INDEX_CHUNK; b < std::min((chunk+1)*INDEX_CHUNK, count); b++) {
+						unpackBoard(grader.grid, records.data()+(size_t)b*header.record_bytes, grader.layout);
+						metrics[b] = grader.analyzer.analyze(grader.layout);
+					}
+			};
+			std::vector<std::thread> workers;
+			for (int t = 1; t < threads; t++)
+				workers.emplace_back(work, t);
+			work(0);
+			for (std::thread& worker : workers)
+				worker.join();
+
+			for (int b = 0; b < count; b++) {
+				const uint8_t* record = records.data()+(size_t)b*header.record_bytes;
+				uint32_t seed;
+				std::memcpy(&seed, record, 4);
+				writer.add(header.height, header.width, header.bomb_cnt, seed, record+4, metrics[b]);
+			}
+			boards += count;
+		}
+	}
+
+	if(!writer.close()) {
+		std::cerr << "failed writing " << argv[2] << std::endl;
+		return 1;
+	}
+	double seconds = std::chrono::duration<double>(Clock::now()-start).count();
+	std::printf("%ld boards indexed in %.2f s (%.0f boards/min)\n", boards, seconds, boards/seconds*60);
+	return 0;
+}
+
+static int queryCorpus(int argc, char** argv) {
+	int height = 16, width = 30, bombs = EXPERT_BOMBS;
+	int min_bbbv = 0, max_bbbv = 1 << 30, min_openings = 0, max_openings = 1 << 30;
+	bool no_guess = false;
+	long limit = -1;
+	for (int i = 3; i < argc; i++) {
+		if(!std::strcmp(argv[i], "--board") && i+1 < argc && parseBoard(argv[i+1], height, width, bombs))
+			i++;
+		else if(!std::strcmp(argv[i], "--min-3bv") && i+1 < argc)
+			min_bbbv = std::atoi(argv[++i]);
+		else if(!std::strcmp(argv[i], "--max-3bv") && i+1 < argc)
+			max_bbbv = std::atoi(argv[++i]);
+		else if(!std::strcmp(argv[i], "--min-openings") && i+1 < argc)
+			min_openings = std::atoi(argv[++i]);
+		else if(!std::strcmp(argv[i], "--max-openings") && i+1 < argc)
+			max_openings = std::atoi(argv[++i]);
+		else if(!std::strcmp(argv[i], "--no-guess"))
+			no_guess = true;
+		else if(!std::strcmp(argv[i], "--limit") && i+1 < argc)
+			limit = std::atol(argv[++i]);
+		else
+			return usage(argv[0]);
+	}
+
+	CorpusIndex corpus;
+	if(!corpus.open(argv[2])) {
+		std::cerr << argv[2] << " is not an indexed corpus" << std::endl;
+		return 1;
+	}
+	Clock::time_point start = Clock::now();
+	bool by_openings = min_bbbv == 0 && max_bbbv == 1 << 30 && (min_openings > 0 || max_openings < 1 << 30);
+	CorpusRange range = by_openings ? corpus.range(METRIC_OPENINGS, height, width, bombs, min_openings, max_openings)
+									: corpus.range(METRIC_BBBV, height, width, bombs, min_bbbv, max_bbbv);
+
+	long found = 0;
+	for (uint32_t board : range) {
+		if(found == limit)
+			break;
+		int bbbv = corpus.bbbv(board), openings = corpus.openings(board);
+		if(bbbv < min_bbbv || bbbv > max_bbbv || openings < min_openings || openings > max_openings || (no_guess && !corpus.guessFree(board)))
+			continue;
+		std::printf("%u,%d,%d,%d\n", corpus.seed(board), bbbv, openings, (int)corpus.guessFree(board));
+		found++;
+	}
+	double ms = std::chrono::duration<double, std::milli>(Clock::now()-start).count();
+	std::fprintf(stderr, "%ld of %llu boards in %.3f ms (%zu in range)\n", found, (unsigned long long)corpus.count(), ms, range.size());
+	return 0;
+}
+
+int main(int argc, char** argv) {
+	if(argc >= 3 && !std::strcmp(argv[1], "index"))
+		return indexCorpora(argc, argv);
+	if(argc >= 3 && !std::strcmp(argv[1], "query"))
+		return queryCorpus(argc, argv);
+	return usage(argv[0]);
+}
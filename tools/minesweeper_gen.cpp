@@ -0,0 +1,177 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "board_state.h"
+#include "board_analysis.h"
+#include "board_corpus.h"
+
+/*
+minesweeper_gen generates seeded boards on every core and streams them to a
+corpus file (see board_corpus.h).
+
+	minesweeper_gen --out FILE [--boards N] [--seed S] [--board SIZE]
+	                [--threads T] [--no-guess [--max-generated M]]
+
+SIZE is beginner, intermediate, expert (the default) or HEIGHTxWIDTHxBOMBS.
+The seeds of the boards come from S the way the tournament's and
+minesweeper_analyze's do, and boards are generated GEN_BATCH at a time,
+spread over T threads (all cores by default) in chunks of GEN_CHUNK. Every
+thread has its own grid, layout and analyzer, and packs its boards straight
+into their records in the block of the batch. The block then goes to the
+writer thread while the next batch is generated, so the corpus is in seed
+order and the same for any thread count.
+
+With --no-guess, only the boards whose guessing (see board_analysis.h) is 0
+are kept, and boards are generated until N have been kept. On sizes where
+hardly any board is guess-free that could take forever, so no more than M
+boards are generated (GEN_MAX_PER_KEPT times N by default): past that, the
+boards kept so far are left in the corpus and minesweeper_gen fails.
+*/
+#define GEN_BATCH (1 << 16)
+#define GEN_CHUNK 256
+#define GEN_MAX_PER_KEPT 1000
+
+static bool parseBoard(const char* text, int& height, int& width, int& bombs) {
+	if(!std::strcmp(text, "beginner"))
+		height = 9, width = 9, bombs = BEGINNER_BOMBS;
+	else if(!std::strcmp(text, "intermediate"))
+		height = 16, width = 16, bombs = INTERMEDIATE_BOMBS;
+	else if(!std::strcmp(text, "expert"))
+		height = 16, width = 30, bombs = EXPERT_BOMBS;
+	else if(std::sscanf(text, "%dx%dx%d", &height, &width, &bombs) != 3)
+		return false;
+	return height > 0 && width > 0 && bombs >= 0 && bombs < height*width;
+}
+
+//what one thread needs to generate boards, kept from one batch to the next
+struct Generator {
+	Grid<> grid;
+	Grid<>::Array<Cell> layout;
+	BoardAnalyzer<> analyzer;
+
+	Generator(int height, int width) : grid(height, width), analyzer(height, width) {}
+};
+
+int main(int argc, char** argv) {
+	long boards = 1000000, max_generated = -1;
+	int threads = std::thread::hardware_concurrency();
+	int height = 16, width = 30, bombs = EXPERT_BOMBS;
+	unsigned seed = 1;
+	bool no_guess = false;
+	const char* path = nullptr;
+
+	for (int i = 1; i < argc; i++) {
+		if(!std::strcmp(argv[i], "--boards") && i+1 < argc)
+			boards = std::atol(argv[++i]);
+		else if(!std::strcmp(argv[i], "--seed") && i+1 < argc)
+			seed = std::strtoul(argv[++i], nullptr, 10);
+		else if(!std::strcmp(argv[i], "--board") && i+1 < argc && parseBoard(argv[i+1], height, width, bombs))
+			i++;
+		else if(!std::strcmp(argv[i], "--threads") && i+1 < argc)
+			threads = std::atoi(argv[++i]);
+		else if(!std::strcmp(argv[i], "--no-guess"))
+			no_guess = true;
+		else if(!std::strcmp(argv[i], "--max-generated") && i+1 < argc)
+			max_generated = std::atol(argv[++i]);
+		else if(!std::strcmp(argv[i], "--out") && i+1 < argc)
+			path = argv[++i];
+		else {
+			path = nullptr;
+			break;
+		}
+	}
+	if(!path) {
+		std::cerr << "usage: " << argv[0] << " --out FILE [--boards N] [--seed S] [--board beginner|intermediate|expert|HxWxB]"
+				  << " [--threads T] [--no-guess [--max-generated M]]" << std::endl;
+		return 2;
+	}
+	if(boards <= 0) {
+		std::cerr << "nothing to generate" << std::endl;
+		return 2;
+	}
+	threads = threads < 1 ? 1 : threads;
+	if(max_generated < 0)
+		max_generated = boards*GEN_MAX_PER_KEPT;
+
+	CorpusWriter writer;
+	if(!writer.open(path, corpusHeader(height, width, bombs, seed, no_guess ? CORPUS_GUESS_FREE : 0))) {
+		std::cerr << "can't write " << path << std::endl;
+		return 1;
+	}
+
+	int record_bytes = corpusRecordBytes(height, width);
+	std::vector<Generator> generators(threads, Generator(height, width));
+	std::vector<unsigned> seeds(GEN_BATCH);
+	std::vector<int8_t> kept(GEN_BATCH);
+	std::minstd_rand random(seed);
+	long generated = 0, written = 0;
+	Clock::time_point start = Clock::now();
+
+	while(written < boards && (!no_guess || generated < max_generated)) {
+		//without the filter every board is kept, so the last batch is cut to
+		//what is missing, and with it to what is left of the boards allowed
+		int count = (int)std::min<long>(GEN_BATCH, no_guess ? max_generated-generated : boards-written);
+		for (int b = 0; b < count; b++)
+			seeds[b] = random();
+		std::vector<uint8_t> block((size_t)count*record_bytes);
+
+		std::atomic<int> next(0);
+		auto work = [&](int t) {
+			Generator& generator = generators[t];
+			for (int chunk = next++; chunk*GEN_CHUNK < count; chunk = next++)
+				for (int b = chunk*GEN_CHUNK; b < std::min((chunk+1)*GEN_CHUNK, count); b++) {
+					generator.grid.allocate(generator.layout, Cell(), Cell::sentinel());
+					Cell::initBoard(generator.layout, generator.grid, bombs, seeds[b]);
+					generator.grid.forEachCell([&](int idx) { generator.layout[idx].setVisibility(FREE); });
+					kept[b] = !no_guess || generator.analyzer.analyze(generator.layout).guessing == 0;
+					if(kept[b])
+						packBoard(generator.grid, generator.layout, seeds[b], block.data()+(size_t)b*record_bytes);
+				}
+		};
+		std::vector<std::thread> workers;
+		for (int t = 1; t < threads; t++)
+			workers.emplace_back(work, t);
+		work(0);
+		for (std::thread& worker : workers)
+			worker.join();
+		generated += count;
+
+		//the kept records are moved to the front of the block, in seed order
+		size_t used = 0;
+		for (int b = 0; b < count && written < boards; b++) {
+			if(!kept[b])
+				continue;
+			if(used != (size_t)b*record_bytes)
+				std::memmove(block.data()+used, block.data()+(size_t)b*record_bytes, record_bytes);
+			used += record_bytes;
+			written++;
+		}
+		block.resize(used);
+		if(used)
+			writer.write(std::move(block));
+	}
+
+	if(!writer.close()) {
+		std::cerr << "failed writing " << path << std::endl;
+		return 1;
+	}
+	if(written < boards) {
+		std::cerr << "only " << written << " of " << boards << " boards were guess-free after " << generated
+				  << " generated, giving up (see --max-generated)" << std::endl;
+		return 1;
+	}
+	double seconds = std::chrono::duration<double>(Clock::now()-start).count();
+	std::printf("%ld boards of %dx%d with %d bombs, seed %u, in %.2f s (%.0f boards/min)\n", written, height, width, bombs, seed, seconds,
+				written/seconds*60);
+	if(no_guess)
+		std::printf("%ld generated, %.2f%% guess-free\n", generated, 100.0*written/generated);
+	std::printf("%.1f MB written to %s\n", (sizeof(CorpusHeader)+(double)written*record_bytes)/(1 << 20), path);
+	return 0;
+}
@@ -0,0 +1,239 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "board_state.h"
+#include "observation.h"
+#include "latency.h"
+#include "profiler.h"
+#include "solver.h"
+#include "basic_solvers.h"
+#include "pattern_solver.h"
+#include "elimination_solver.h"
+#include "probability_solver.h"
+#include "lookahead_solver.h"
+#include "endgame_solver.h"
+#include "solver_plugin.h"
+
+/*
+minesweeper_tournament plays every registered solver on the same set of
+seeded boards and compares them.
+
+	minesweeper_tournament [--games N] [--seed S] [--board SIZE]
+	                       [--threads T] [--solver NAME]... [--plugin FILE]...
+	                       [--json FILE]
+
+SIZE is beginner, intermediate, expert (the default) or HEIGHTxWIDTHxBOMBS.
+Every --plugin library (see minesweeper_solver.h) joins the built-in
+solvers; --solver keeps only the named ones. Games are spread over T threads
+(all cores by default), but every game has its own seed for the board and
+the solver, so the results do not depend on the thread count.
+
+A game a solver has not finished after MAX_MOVES_PER_CELL moves per cell
+counts as lost (stalled). For every solver the report gives the win rate,
+the average time spent in nextMove and the distribution of the time taken
+by a whole game, followed by how often the solvers found a frontier
+component in the shared cache (see component_cache.h).
+
+In a build with the profiler (see profiler.h), setting MINESWEEPER_TRACE to
+a file name records every call to nextMove there as a Chrome trace, like the
+game does.
+*/
+#define MAX_MOVES_PER_CELL 4
+
+struct GameResult {
+	bool won, stalled;
+	int moves;
+	Clock::duration thinking, total;
+};
+
+struct Standing {
+	std::string name;
+	int games, wins, stalled;
+	long moves;
+	Clock::duration thinking;
+	LatencyHistogram game_time;
+};
+
+static GameResult play(Solver& solver, int height, int width, int bombs, unsigned seed, std::vector<int8_t>& contents) {
+	GameResult result = {false, false, 0, Clock::duration::zero(), Clock::duration::zero()};
+	Clock::time_point start = Clock::now();
+
+	BoardState<> board(height, width, bombs, seed);
+	board.trackFrontier(true);
+	const Frontier<>& frontier = board.frontier();
+	Observation observation = {contents.data(), height, width, bombs, &frontier.cells(), &frontier.constraints()};
+	solver.newGame(height, width, bombs);
+
+	while(!board.endOfGame()) {
+		if(result.moves == MAX_MOVES_PER_CELL*height*width) {
+			result.stalled = true;
+			break;
+		}
+
+		exportContents(board.view(), contents.data(), width);
+		Clock::time_point before = Clock::now();
+		Action action;
+		{
+			PROFILE_SCOPE("Solver::nextMove");
+			action = solver.nextMove(observation);
+		}
+		result.thinking += Clock::now()-before;
+
+		board.apply(action);
+		result.moves++;
+	}
+
+	result.won = board.won();
+	result.total = Clock::now()-start;
+	return result;
+}
+
+static bool parseBoard(const char* text, int& height, int& width, int& bombs) {
+	if(!std::strcmp(text, "beginner"))
+		height = 9, width = 9, bombs = BEGINNER_BOMBS;
+	else if(!std::strcmp(text, "intermediate"))
+		height = 16, width = 16, bombs = INTERMEDIATE_BOMBS;
+	else if(!std::strcmp(text, "expert"))
+		height = 16, width = 30, bombs = EXPERT_BOMBS;
+	else if(std::sscanf(text, "%dx%dx%d", &height, &width, &bombs) != 3)
+		return false;
+	return height > 0 && width > 0 && bombs >= 0 && bombs < height*width;
+}
+
+static void writeJson(std::ostream& out, const std::vector<Standing>& standings) {
+	out.precision(10);
+	out << "{\n  \"solvers\": [\n";
+	for (size_t i = 0; i < standings.size(); i++) {
+		const Standing& s = standings[i];
+		out << "    {\"name\": \"" << s.name << "\", \"games\": " << s.games << ", \"wins\": " << s.wins
+			<< ", \"stalled\": " << s.stalled << ", \"moves\": " << s.moves
+			<< ", \"us_per_move\": " << (s.moves ? std::chrono::duration<double, std::micro>(s.thinking).count()/s.moves : 0)
+			<< ", \"game_us\": {\"mean\": " << (s.games ? s.game_time._sum_us/s.games : 0)
+			<< ", \"p50\": " << s.game_time.percentile(0.5) << ", \"p90\": " << s.game_time.percentile(0.9)
+			<< ", \"p99\": " << s.game_time.percentile(0.99) << ", \"max\": " << s.game_time._max_us << "}}"
+			<< (i+1 < standings.size() ? "," : "") << "\n";
+	}
+	out << "  ]\n}\n";
+}
+
+int main(int argc, char** argv) {
+	int games = 1000, threads = std::thread::hardware_concurrency();
+	int height = 16, width = 30, bombs = EXPERT_BOMBS;
+	unsigned seed = 1;
+	const char* json = nullptr;
+	std::vector<std::string> only;
+
+	registerBasicSolvers();
+	registerPatternSolver();
+	registerEliminationSolver();
+	registerProbabilitySolver();
+	registerLookaheadSolver();
+	registerEndgameSolver();
+
+	for (int i = 1; i < argc; i++) {
+		if(!std::strcmp(argv[i], "--games") && i+1 < argc)
+			games = std::atoi(argv[++i]);
+		else if(!std::strcmp(argv[i], "--seed") && i+1 < argc)
+			seed = std::strtoul(argv[++i], nullptr, 10);
+		else if(!std::strcmp(argv[i], "--board") && i+1 < argc && parseBoard(argv[i+1], height, width, bombs))
+			i++;
+		else if(!std::strcmp(argv[i], "--threads") && i+1 < argc)
+			threads = std::atoi(argv[++i]);
+		else if(!std::strcmp(argv[i], "--solver") && i+1 < argc)
+			only.push_back(argv[++i]);
+		else if(!std::strcmp(argv[i], "--plugin") && i+1 < argc) {
+			if(!loadSolverPlugin(argv[++i]))
+				return 2;
+		}
+		else if(!std::strcmp(argv[i], "--json") && i+1 < argc)
+			json = argv[++i];
+		else {
+			std::cerr << "usage: " << argv[0] << " [--games N] [--seed S] [--board beginner|intermediate|expert|HxWxB] [--threads T] [--solver NAME]... [--plugin FILE]... [--json FILE]" << std::endl;
+			return 2;
+		}
+	}
+
+	std::vector<SolverEntry> solvers;
+	for (const SolverEntry& entry : solverRegistry())
+		if(only.empty() || std::find(only.begin(), only.end(), entry.name) != only.end())
+			solvers.push_back(entry);
+	if(solvers.empty() || games <= 0) {
+		std::cerr << "nothing to play" << std::endl;
+		return 2;
+	}
+	threads = threads < 1 ? 1 : threads;
+
+	//every solver plays the same boards
+	std::vector<unsigned> seeds(games);
+	std::minstd_rand random(seed);
+	for (unsigned& s : seeds)
+		s = random();
+
+	const char* trace = std::getenv("MINESWEEPER_TRACE");
+	Profiler::instance().enable(trace != nullptr);
+
+	std::vector<GameResult> results(solvers.size()*games);
+	std::atomic<int> next(0);
+	std::vector<std::thread> workers;
+
+	for (int t = 0; t < threads; t++)
+		workers.emplace_back([&]() {
+			std::vector<int8_t> contents(height*width);
+			for (int job = next++; job < (int)results.size(); job = next++) {
+				const SolverEntry& entry = solvers[job/games];
+				unsigned game_seed = seeds[job%games];
+				std::unique_ptr<Solver> solver = entry.create(game_seed);
+				results[job] = play(*solver, height, width, bombs, game_seed, contents);
+			}
+		});
+	for (std::thread& worker : workers)
+		worker.join();
+
+	std::vector<Standing> standings;
+	std::printf("%d games on %dx%d with %d bombs, seed %u\n\n", games, height, width, bombs, seed);
+	std::printf("%-20s %8s %8s %12s %12s %12s %12s\n", "solver", "win %", "stalled", "us/move", "game p50 us", "game p90 us", "game p99 us");
+
+	for (size_t s = 0; s < solvers.size(); s++) {
+		Standing standing = {solvers[s].name, games, 0, 0, 0, Clock::duration::zero(), LatencyHistogram()};
+		for (int g = 0; g < games; g++) {
+			const GameResult& result = results[s*games+g];
+			standing.wins += result.won;
+			standing.stalled += result.stalled;
+			standing.moves += result.moves;
+			standing.thinking += result.thinking;
+			standing.game_time.record(result.total);
+		}
+
+		double us_per_move = standing.moves ? std::chrono::duration<double, std::micro>(standing.thinking).count()/standing.moves : 0;
+		std::printf("%-20s %8.2f %8d %12.2f %12.0f %12.0f %12.0f\n", standing.name.c_str(), 100.0*standing.wins/games, standing.stalled,
+					us_per_move, standing.game_time.percentile(0.5), standing.game_time.percentile(0.9), standing.game_time.percentile(0.99));
+		standings.push_back(standing);
+	}
+
+	const ComponentCache& cache = ComponentCache::shared();
+	if(cache.hits()+cache.misses())
+		std::printf("\ncomponent cache: %.1f%% of %llu lookups hit\n", 100.0*cache.hits()/(cache.hits()+cache.misses()),
+					(unsigned long long)(cache.hits()+cache.misses()));
+
+	if(json) {
+		if(!std::strcmp(json, "-"))
+			writeJson(std::cout, standings);
+		else {
+			std::ofstream out(json);
+			writeJson(out, standings);
+		}
+	}
+	if(trace) {
+		std::ofstream out(trace);
+		Profiler::instance().writeChromeTrace(out);
+	}
+	return 0;
+}